@@ -0,0 +1,153 @@
+#include "budgetengine.h"
+#include <QDebug>
+
+BudgetEngine::BudgetEngine(QObject *parent)
+    : QObject(parent) {}
+
+QString BudgetEngine::key(const QString &category, const QString &month) {
+    return category + '|' + month;
+}
+
+void BudgetEngine::load() {
+    totals.clear();
+    levels.clear();
+    limits = Database::budgetLimits();
+    fx.load();
+
+    QSqlQuery query = Database::getBudgetTotals();
+    while (query.next()) {
+        totals[key(query.value(0).toString(), query.value(1).toString())].insert(query.value(2).toString(), query.value(3).toDouble());
+    }
+
+    // Seed levels silently so startup does not replay old alerts
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        int separator = it.key().lastIndexOf('|');
+        QString category = it.key().left(separator);
+        if (limits.value(category, 0.0) > 0) {
+            levels.insert(it.key(), levelFor(category, it.key().mid(separator + 1)));
+        }
+    }
+
+    qDebug() << "Loaded" << totals.size() << "budget totals and" << limits.size() << "limits";
+}
+
+void BudgetEngine::reloadRates() {
+    fx.load();
+    missingRates.clear();
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        int separator = it.key().lastIndexOf('|');
+        evaluate(it.key().left(separator), it.key().mid(separator + 1));
+    }
+}
+
+void BudgetEngine::recordAdded(const TransactionRecord &record) {
+    if (record.type != "Expense") return;
+    applyDelta(record.category, record.date.toString("yyyy-MM"), record.currency, record.amount);
+}
+
+void BudgetEngine::recordRemoved(const TransactionRecord &record) {
+    if (record.type != "Expense") return;
+    applyDelta(record.category, record.date.toString("yyyy-MM"), record.currency, -record.amount);
+}
+
+void BudgetEngine::recordUpdated(const TransactionRecord &before, const TransactionRecord &after) {
+    recordRemoved(before);
+    recordAdded(after);
+}
+
+void BudgetEngine::refresh(const QString &category, const QString &month) {
+    QHash<QString, double> spentByCurrency = Database::budgetSpent(category, month);
+    if (spentByCurrency.isEmpty()) {
+        totals.remove(key(category, month));
+    } else {
+        totals.insert(key(category, month), spentByCurrency);
+    }
+    evaluate(category, month);
+}
+
+bool BudgetEngine::setLimit(const QString &category, double monthlyLimit) {
+    if (!Database::setBudgetLimit(category, monthlyLimit)) return false;
+
+    if (monthlyLimit > 0) {
+        limits.insert(category, monthlyLimit);
+    } else {
+        limits.remove(category);
+    }
+
+    // A new limit can put the current month over budget immediately
+    QString month = QDate::currentDate().toString("yyyy-MM");
+    levels.remove(key(category, month));
+    evaluate(category, month);
+    return true;
+}
+
+double BudgetEngine::limit(const QString &category) const {
+    return limits.value(category, 0.0);
+}
+
+double BudgetEngine::spent(const QString &category, const QString &month, QStringList *unconverted) {
+    auto it = totals.constFind(key(category, month));
+    if (it == totals.constEnd()) return 0.0;
+
+    // One rate per month, taken at its last day or today for the running month
+    QDate first = QDate::fromString(month + "-01", "yyyy-MM-dd");
+    qint64 day = qMin(first.addMonths(1).addDays(-1), QDate::currentDate()).toJulianDay();
+
+    double total = 0.0;
+    for (auto amount = it.value().constBegin(); amount != it.value().constEnd(); ++amount) {
+        // Counting a foreign amount as base currency could raise a false alert, so it is left out instead
+        double rate = fx.rate(amount.key(), day);
+        if (rate > 0) {
+            total += amount.value() * rate;
+            continue;
+        }
+        if (amount.value() == 0.0) continue;
+        if (unconverted) unconverted->append(amount.key());
+        if (!missingRates.contains(amount.key())) {
+            missingRates.insert(amount.key());
+            emit ratesMissing(amount.key());
+        }
+    }
+    return total;
+}
+
+qint64 BudgetEngine::memoryUsage() const {
+    qint64 bytes = fx.memoryUsage();
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        bytes += sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(QHash<QString, double>) + 2 * sizeof(void *) + 8;
+        bytes += it.value().size() * (sizeof(QString) + 3 * sizeof(QChar) + sizeof(double) + 2 * sizeof(void *) + 8);
+    }
+    for (auto it = limits.constBegin(); it != limits.constEnd(); ++it) {
+        bytes += sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(double) + 2 * sizeof(void *) + 8;
+    }
+    for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
+        bytes += sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(int) + 2 * sizeof(void *) + 8;
+    }
+    return bytes;
+}
+
+void BudgetEngine::applyDelta(const QString &category, const QString &month, const QString &currency, double delta) {
+    totals[key(category, month)][currency] += delta;
+    evaluate(category, month);
+}
+
+int BudgetEngine::levelFor(const QString &category, const QString &month) {
+    double cap = limits.value(category, 0.0);
+    double spentSoFar = spent(category, month);
+    return spentSoFar >= cap ? OverLimit : spentSoFar >= cap * NearLimitRatio ? NearLimit : WithinBudget;
+}
+
+void BudgetEngine::evaluate(const QString &category, const QString &month) {
+    double cap = limits.value(category, 0.0);
+    if (cap <= 0) return;
+
+    QString k = key(category, month);
+    int level = levelFor(category, month);
+    int previous = levels.value(k, WithinBudget);
+    levels.insert(k, level);
+
+    // Only upward crossings alert; dropping back below a threshold re-arms it silently
+    if (level > previous) {
+        emit budgetAlert(category, month, spent(category, month), cap, level);
+    }
+}
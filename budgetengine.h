@@ -0,0 +1,59 @@
+#ifndef BUDGETENGINE_H
+#define BUDGETENGINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include "database.h"
+#include "fxconverter.h"
+
+// In-memory mirror of the budgets table. Every ledger change is applied as a
+// delta to one (category, month, currency) total and checked against that
+// category's limit, so alert evaluation never rescans the ledger. Limits are
+// in the base currency; totals are converted at the month's rate to compare.
+class BudgetEngine : public QObject {
+    Q_OBJECT
+
+public:
+    enum Level { WithinBudget = 0, NearLimit = 1, OverLimit = 2 };
+
+    explicit BudgetEngine(QObject *parent = nullptr);
+
+    void load();
+    // Re-reads FX rates after an import and re-checks every month against the new conversion
+    void reloadRates();
+    void recordAdded(const TransactionRecord &record);
+    void recordRemoved(const TransactionRecord &record);
+    void recordUpdated(const TransactionRecord &before, const TransactionRecord &after);
+    // Re-reads one total from the budgets table after another process changed it
+    void refresh(const QString &category, const QString &month);
+
+    bool setLimit(const QString &category, double monthlyLimit);
+    double limit(const QString &category) const;
+    // Spending in the base currency; amounts in currencies without a rate are left out and listed in unconverted
+    double spent(const QString &category, const QString &month, QStringList *unconverted = nullptr);
+    qint64 memoryUsage() const;
+
+    static constexpr double NearLimitRatio = 0.8;
+
+signals:
+    // Emitted once per threshold crossing; connect with Qt::QueuedConnection to keep writers unblocked
+    void budgetAlert(const QString &category, const QString &month, double spent, double limit, int level);
+    // Emitted the first time a currency without a rate is left out of a budget check
+    void ratesMissing(const QString &currency);
+
+private:
+    static QString key(const QString &category, const QString &month);
+    void applyDelta(const QString &category, const QString &month, const QString &currency, double delta);
+    void evaluate(const QString &category, const QString &month);
+    int levelFor(const QString &category, const QString &month);
+
+    FxConverter fx;
+    QHash<QString, QHash<QString, double>> totals;  // "category|month" -> currency -> native amount
+    QHash<QString, double> limits;
+    QHash<QString, int> levels;
+    QSet<QString> missingRates;  // currencies already reported through ratesMissing
+};
+
+#endif
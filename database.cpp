@@ -1,10 +1,19 @@
 #include "database.h"
 #include <QSqlError>
 #include <QDebug>
+#include <QPair>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QUrl>
+#include <QStringList>
+#include <algorithm>
 
-bool Database::initialize() {
+bool Database::initialize(const QString &path) {
     QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("finance_tracker.db"); 
+    db.setDatabaseName(path);
+    // Lets archives be attached read-only through file: URIs; plain paths open as before
+    db.setConnectOptions("QSQLITE_OPEN_URI");
 
     if (!db.open()) {
         qDebug() << "Database error:" << db.lastError().text();
@@ -28,19 +37,353 @@ bool Database::initialize() {
         return false;
     }
 
+    // Older databases predate the fingerprint column
+    if (!hasColumn("transactions", "fingerprint")) {
+        if (!query.exec("ALTER TABLE transactions ADD COLUMN fingerprint INTEGER")) {
+            qDebug() << "Failed to add fingerprint column:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!hasColumn("transactions", "currency")) {
+        if (!query.exec("ALTER TABLE transactions ADD COLUMN currency TEXT NOT NULL DEFAULT 'EUR'")) {
+            qDebug() << "Failed to add currency column:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // Rates are units of the base currency (EUR) per one unit of `currency` on `date`
+    QString createFxRates = R"(
+        CREATE TABLE IF NOT EXISTS fx_rates (
+            currency TEXT NOT NULL,
+            date TEXT NOT NULL,
+            rate REAL NOT NULL,
+            PRIMARY KEY (currency, date)
+        )
+    )";
+
+    if (!query.exec(createFxRates)) {
+        qDebug() << "Failed to create fx_rates table:" << query.lastError().text();
+        return false;
+    }
+
+    QString createRecurringRules = R"(
+        CREATE TABLE IF NOT EXISTS recurring_rules (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            description TEXT,
+            category TEXT NOT NULL,
+            amount REAL NOT NULL,
+            type TEXT NOT NULL,
+            currency TEXT NOT NULL DEFAULT 'EUR',
+            start_date TEXT NOT NULL,
+            rrule TEXT NOT NULL,
+            materialized_through TEXT
+        )
+    )";
+
+    if (!query.exec(createRecurringRules)) {
+        qDebug() << "Failed to create recurring_rules table:" << query.lastError().text();
+        return false;
+    }
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_transactions_fingerprint ON transactions(fingerprint)")) {
+        qDebug() << "Failed to create fingerprint index:" << query.lastError().text();
+        return false;
+    }
+
+    // Most queries filter on the last few months, so keep the hot partition indexed by date
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_transactions_date ON transactions(date)")) {
+        qDebug() << "Failed to create date index:" << query.lastError().text();
+        return false;
+    }
+
+    // Closed years live in read-only per-year files; this table routes queries to them
+    QString createPartitions = R"(
+        CREATE TABLE IF NOT EXISTS partitions (
+            year INTEGER PRIMARY KEY,
+            path TEXT NOT NULL,
+            row_count INTEGER NOT NULL,
+            min_date TEXT,
+            max_date TEXT,
+            archived_at TEXT NOT NULL
+        )
+    )";
+
+    if (!query.exec(createPartitions)) {
+        qDebug() << "Failed to create partitions table:" << query.lastError().text();
+        return false;
+    }
+
+    // Change log written by triggers, so edits from any process (imports, other windows) are recorded
+    QString createChanges = R"(
+        CREATE TABLE IF NOT EXISTS changes (
+            seq INTEGER PRIMARY KEY AUTOINCREMENT,
+            op TEXT NOT NULL,
+            row_id INTEGER NOT NULL,
+            changed_at TEXT NOT NULL DEFAULT (datetime('now'))
+        )
+    )";
+
+    const QStringList changeTriggers = {
+        "CREATE TRIGGER IF NOT EXISTS transactions_log_insert AFTER INSERT ON transactions "
+        "BEGIN INSERT INTO changes (op, row_id) VALUES ('insert', NEW.id); END",
+        "CREATE TRIGGER IF NOT EXISTS transactions_log_update AFTER UPDATE ON transactions "
+        "BEGIN INSERT INTO changes (op, row_id) VALUES ('update', NEW.id); END",
+        "CREATE TRIGGER IF NOT EXISTS transactions_log_delete AFTER DELETE ON transactions "
+        "BEGIN INSERT INTO changes (op, row_id) VALUES ('delete', OLD.id); END"
+    };
+
+    if (!query.exec(createChanges)) {
+        qDebug() << "Failed to create changes table:" << query.lastError().text();
+        return false;
+    }
+
+    for (const QString &trigger : changeTriggers) {
+        if (!query.exec(trigger)) {
+            qDebug() << "Failed to create change trigger:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!initializeBudgets()) {
+        return false;
+    }
+
+    return backfillFingerprints();
+}
+
+// Per-(category, month, currency) expense totals kept current by triggers, so every writer applies O(1) deltas.
+// Amounts stay in their own currency; BudgetEngine converts when it compares against a limit.
+bool Database::initializeBudgets() {
+    QSqlQuery query;
+    query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'budgets'");
+    bool seedTotals = !query.next();
+
+    // Totals from before the currency column summed every currency together; they are rebuilt from the ledger
+    bool legacyTotals = false;
+    if (!seedTotals) {
+        legacyTotals = true;
+        query.exec("PRAGMA table_info(budgets)");
+        while (query.next()) {
+            if (query.value(1).toString() == "currency") legacyTotals = false;
+        }
+    }
+
+    QString createBudgets = R"(
+        CREATE TABLE IF NOT EXISTS budgets (
+            category TEXT NOT NULL,
+            month TEXT NOT NULL,
+            currency TEXT NOT NULL DEFAULT 'EUR',
+            spent REAL NOT NULL DEFAULT 0,
+            PRIMARY KEY (category, month, currency)
+        )
+    )";
+
+    QString createLimits = R"(
+        CREATE TABLE IF NOT EXISTS budget_limits (
+            category TEXT PRIMARY KEY,
+            monthly_limit REAL NOT NULL
+        )
+    )";
+
+    const QStringList budgetTriggers = {
+        R"(CREATE TRIGGER IF NOT EXISTS transactions_budget_insert AFTER INSERT ON transactions
+           WHEN NEW.type = 'Expense' BEGIN
+               INSERT OR IGNORE INTO budgets (category, month, currency, spent) VALUES (NEW.category, substr(NEW.date, 1, 7), NEW.currency, 0);
+               UPDATE budgets SET spent = spent + NEW.amount
+                   WHERE category = NEW.category AND month = substr(NEW.date, 1, 7) AND currency = NEW.currency;
+           END)",
+        R"(CREATE TRIGGER IF NOT EXISTS transactions_budget_delete AFTER DELETE ON transactions
+           WHEN OLD.type = 'Expense' BEGIN
+               UPDATE budgets SET spent = spent - OLD.amount
+                   WHERE category = OLD.category AND month = substr(OLD.date, 1, 7) AND currency = OLD.currency;
+           END)",
+        R"(CREATE TRIGGER IF NOT EXISTS transactions_budget_update AFTER UPDATE OF date, category, amount, type, currency ON transactions BEGIN
+               UPDATE budgets SET spent = spent - OLD.amount
+                   WHERE OLD.type = 'Expense' AND category = OLD.category AND month = substr(OLD.date, 1, 7) AND currency = OLD.currency;
+               INSERT OR IGNORE INTO budgets (category, month, currency, spent)
+                   SELECT NEW.category, substr(NEW.date, 1, 7), NEW.currency, 0 WHERE NEW.type = 'Expense';
+               UPDATE budgets SET spent = spent + NEW.amount
+                   WHERE NEW.type = 'Expense' AND category = NEW.category AND month = substr(NEW.date, 1, 7) AND currency = NEW.currency;
+           END)"
+    };
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    bool ok = true;
+    if (legacyTotals) {
+        ok = query.exec("DROP TRIGGER IF EXISTS transactions_budget_insert")
+             && query.exec("DROP TRIGGER IF EXISTS transactions_budget_delete")
+             && query.exec("DROP TRIGGER IF EXISTS transactions_budget_update")
+             && query.exec("DROP TABLE budgets");
+    }
+
+    ok = ok && query.exec(createBudgets) && query.exec(createLimits);
+    for (int i = 0; ok && i < budgetTriggers.size(); ++i) {
+        ok = query.exec(budgetTriggers[i]);
+    }
+
+    // One full scan when the table is first created; from then on the triggers keep it current
+    if (ok && (seedTotals || legacyTotals)) {
+        ok = query.exec("INSERT INTO budgets (category, month, currency, spent) "
+                        "SELECT category, substr(date, 1, 7), currency, SUM(amount) FROM transactions "
+                        "WHERE type = 'Expense' GROUP BY category, substr(date, 1, 7), currency");
+    }
+
+    if (!ok) {
+        qDebug() << "Failed to initialize budgets:" << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    db.commit();
+    return true;
+}
+
+// Accepts "table" or "schema.table" for attached databases
+bool Database::hasColumn(const QString &table, const QString &column) {
+    int dot = table.indexOf('.');
+    QString pragma = dot == -1 ? QString("PRAGMA table_info(%1)").arg(table)
+                               : QString("PRAGMA %1.table_info(%2)").arg(table.left(dot), table.mid(dot + 1));
+    QSqlQuery query(pragma);
+    while (query.next()) {
+        if (query.value(1).toString() == column) return true;
+    }
+    return false;
+}
+
+bool Database::backfillFingerprints() {
+    // user_version records which fingerprint recipe the stored hashes use; older ones are all recomputed
+    QSqlQuery version("PRAGMA user_version");
+    bool stale = version.next() && version.value(0).toInt() < FingerprintVersion;
+
+    // Collect first: updating the indexed column while scanning it is not safe
+    QVector<QPair<int, qint64>> pending;
+    QSqlQuery select(QString("SELECT id, date, amount, type, description, currency FROM transactions%1")
+                         .arg(stale ? QString() : QString(" WHERE fingerprint IS NULL")));
+    while (select.next()) {
+        pending.append(qMakePair(select.value(0).toInt(),
+                                 static_cast<qint64>(fingerprint(select.value(1).toString(), select.value(2).toDouble(),
+                                                                 select.value(3).toString(), select.value(4).toString(),
+                                                                 select.value(5).toString()))));
+    }
+    if (pending.isEmpty() && !stale) return true;
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+    QSqlQuery update;
+    update.prepare("UPDATE transactions SET fingerprint = ? WHERE id = ?");
+
+    for (const auto &row : pending) {
+        update.addBindValue(row.second);
+        update.addBindValue(row.first);
+        if (!update.exec()) {
+            qDebug() << "Failed to backfill fingerprint:" << update.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (stale && !update.exec(QString("PRAGMA user_version = %1").arg(FingerprintVersion))) {
+        qDebug() << "Failed to record fingerprint version:" << update.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    db.commit();
+    if (!pending.isEmpty()) {
+        qDebug() << "Backfilled fingerprints for" << pending.size() << "transactions";
+    }
     return true;
 }
 
-bool Database::addTransaction(const QString &date, const QString &category, const QString &description, double amount, const QString &type) {
+quint64 Database::fingerprint(const QString &date, double amount, const QString &type, const QString &description, const QString &currency) {
+    QString normalized = QString("%1|%2|%3|%4|%5")
+                             .arg(date)
+                             .arg(qRound64(amount * 100))
+                             .arg(type.toLower())
+                             .arg(currency.toUpper())
+                             .arg(description.simplified().toLower());
+
+    quint64 hash = 14695981039346656037ULL;
+    const QByteArray bytes = normalized.toUtf8();
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Id of an existing transaction with the same fingerprint, or -1
+int Database::findDuplicate(const QString &date, double amount, const QString &type, const QString &description,
+                            const QString &currency, int excludeId) {
+    QSqlQuery query;
+    query.prepare("SELECT id, date, amount, type, description, currency FROM transactions WHERE fingerprint = ? AND id != ?");
+    query.addBindValue(static_cast<qint64>(fingerprint(date, amount, type, description, currency)));
+    query.addBindValue(excludeId);
+
+    if (!query.exec()) {
+        qDebug() << "Failed to look up fingerprint:" << query.lastError().text();
+        return -1;
+    }
+
+    // Guard against hash collisions by comparing the normalized fields
+    auto matches = [&](const QSqlQuery &row) {
+        return row.value(1).toString() == date
+            && qRound64(row.value(2).toDouble() * 100) == qRound64(amount * 100)
+            && row.value(3).toString().compare(type, Qt::CaseInsensitive) == 0
+            && row.value(5).toString().compare(currency, Qt::CaseInsensitive) == 0
+            && row.value(4).toString().simplified().compare(description.simplified(), Qt::CaseInsensitive) == 0;
+    };
+    while (query.next()) {
+        if (matches(query)) return query.value(0).toInt();
+    }
+
+    // A row in an archived year can only collide with rows of that year's partition
+    QSqlQuery partition;
+    partition.prepare("SELECT path FROM partitions WHERE year = ?");
+    partition.addBindValue(date.left(4).toInt());
+    if (!partition.exec() || !partition.next()) return -1;
+    QString path = partition.value(0).toString();
+    partition.finish();
+    if (!attachPartition(path, "cold")) return -1;
+
+    // Archives may predate the fingerprint column, so they are searched by their date index
+    int id = -1;
+    QString cold = hasColumn("cold.transactions", "currency") ? "currency" : "'EUR'";
+    QSqlQuery archived;
+    archived.prepare(QString("SELECT id, date, amount, type, description, %1 FROM cold.transactions WHERE date = ? AND id != ?").arg(cold));
+    archived.addBindValue(date);
+    archived.addBindValue(excludeId);
+    if (archived.exec()) {
+        while (id == -1 && archived.next()) {
+            if (matches(archived)) id = archived.value(0).toInt();
+        }
+    } else {
+        qDebug() << "Failed to search archive" << path << ":" << archived.lastError().text();
+    }
+    archived.finish();
+
+    QSqlQuery detach;
+    if (!detach.exec("DETACH DATABASE cold")) {
+        qDebug() << "Failed to detach archive:" << detach.lastError().text();
+    }
+    return id;
+}
+
+bool Database::addTransaction(const QString &date, const QString &category, const QString &description, double amount, const QString &type, const QString &currency) {
     qDebug() << "Inserting: " << date << category << description << amount;
     
     QSqlQuery query;
-    query.prepare("INSERT INTO transactions (date, category, description, amount, type) VALUES (?, ?, ?, ?, ?)");
+    query.prepare("INSERT INTO transactions (date, category, description, amount, type, currency, fingerprint) VALUES (?, ?, ?, ?, ?, ?, ?)");
     query.addBindValue(date);
     query.addBindValue(category);
     query.addBindValue(description);
     query.addBindValue(amount);
     query.addBindValue(type);
+    query.addBindValue(currency);
+    query.addBindValue(static_cast<qint64>(fingerprint(date, amount, type, description, currency)));
 
     if (!query.exec()) {
         qDebug() << "Failed to add transaction:" << query.lastError().text();
@@ -50,14 +393,16 @@ bool Database::addTransaction(const QString &date, const QString &category, cons
     return true;
 }
 
-bool Database::updateTransaction(int id, const QString &date, const QString &category, const QString &description, double amount, const QString &type) {
+bool Database::updateTransaction(int id, const QString &date, const QString &category, const QString &description, double amount, const QString &type, const QString &currency) {
     QSqlQuery query;
-    query.prepare("UPDATE transactions SET date = ?, category = ?, description = ?, amount = ?, type = ? WHERE id = ?");
+    query.prepare("UPDATE transactions SET date = ?, category = ?, description = ?, amount = ?, type = ?, currency = ?, fingerprint = ? WHERE id = ?");
     query.addBindValue(date);
     query.addBindValue(category);
     query.addBindValue(description);
     query.addBindValue(amount);
     query.addBindValue(type);
+    query.addBindValue(currency);
+    query.addBindValue(static_cast<qint64>(fingerprint(date, amount, type, description, currency)));
     query.addBindValue(id);
 
     if (!query.exec()) {
@@ -81,7 +426,659 @@ bool Database::deleteTransaction(int id) {
     return true;
 }
 
+bool Database::insertTransaction(const TransactionRecord &record) {
+    QString date = record.date.toString("yyyy-MM-dd");
+
+    QSqlQuery query;
+    query.prepare("INSERT INTO transactions (id, date, category, description, amount, type, currency, fingerprint) "
+                  "SELECT ?, ?, ?, ?, ?, ?, ?, ? WHERE NOT EXISTS (SELECT 1 FROM transactions WHERE id = ?)");
+    query.addBindValue(record.id);
+    query.addBindValue(date);
+    query.addBindValue(record.category);
+    query.addBindValue(record.description);
+    query.addBindValue(record.amount);
+    query.addBindValue(record.type);
+    query.addBindValue(record.currency);
+    query.addBindValue(static_cast<qint64>(fingerprint(date, record.amount, record.type, record.description, record.currency)));
+    query.addBindValue(record.id);
+
+    if (!query.exec()) {
+        qDebug() << "Failed to insert transaction" << record.id << ":" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+int Database::reserveTransactionIds(int count) {
+    // IMMEDIATE takes the write lock up front so two processes cannot read the same high-water mark
+    QSqlQuery query;
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        qDebug() << "Failed to reserve transaction ids:" << query.lastError().text();
+        return -1;
+    }
+
+    int first = -1;
+    if (query.exec("SELECT MAX(COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'transactions'), 0), "
+                   "COALESCE((SELECT MAX(id) FROM transactions), 0))") && query.next()) {
+        first = query.value(0).toInt() + 1;
+
+        QSqlQuery update;
+        update.prepare("UPDATE sqlite_sequence SET seq = ? WHERE name = 'transactions'");
+        update.addBindValue(first + count - 1);
+        bool ok = update.exec();
+        if (ok && update.numRowsAffected() == 0) {
+            update.prepare("INSERT INTO sqlite_sequence (name, seq) VALUES ('transactions', ?)");
+            update.addBindValue(first + count - 1);
+            ok = update.exec();
+        }
+        if (!ok) {
+            qDebug() << "Failed to reserve transaction ids:" << update.lastError().text();
+            first = -1;
+        }
+    } else {
+        qDebug() << "Failed to reserve transaction ids:" << query.lastError().text();
+    }
+
+    if (first != -1 && !query.exec("COMMIT")) {
+        qDebug() << "Failed to reserve transaction ids:" << query.lastError().text();
+        first = -1;
+    }
+    if (first == -1) query.exec("ROLLBACK");
+    return first;
+}
+
+QString Database::journalPath(int slot) {
+    QFileInfo mainFile(QSqlDatabase::database().databaseName());
+    QString suffix = slot == 0 ? QString(".journal") : QString(".%1.journal").arg(slot);
+    return mainFile.absoluteDir().filePath(mainFile.completeBaseName() + suffix);
+}
+
 QSqlQuery Database::getAllTransactions() {
-    QSqlQuery query("SELECT id, date, category, description, amount, type FROM transactions ORDER BY date DESC");
+    QSqlQuery query("SELECT id, date, category, description, amount, type, currency FROM transactions ORDER BY date DESC");
+    return query;
+}
+
+// Rows between two dates (inclusive), oldest first. An invalid date leaves that side open.
+// Archived years are attached only when the range overlaps them.
+QVector<TransactionRecord> Database::fetchTransactions(const QDate &from, const QDate &to, const SqlFilter *filter) {
+    QVector<TransactionRecord> records;
+
+    QSqlQuery partitions;
+    partitions.prepare("SELECT year, path FROM partitions WHERE year >= ? AND year <= ? ORDER BY year");
+    partitions.addBindValue(from.isValid() ? from.year() : 0);
+    partitions.addBindValue(to.isValid() ? to.year() : 9999);
+
+    QList<QPair<int, QString>> coldPartitions;
+    if (partitions.exec()) {
+        while (partitions.next()) {
+            coldPartitions.append(qMakePair(partitions.value(0).toInt(), partitions.value(1).toString()));
+        }
+    } else {
+        qDebug() << "Failed to read partitions:" << partitions.lastError().text();
+    }
+
+    for (const auto &partition : coldPartitions) {
+        if (!attachPartition(partition.second, "cold")) {
+            qDebug() << "Skipping archive for" << partition.first;
+            continue;
+        }
+
+        records += fetchFrom("cold.transactions", from, to, filter);
+
+        QSqlQuery detach;
+        if (!detach.exec("DETACH DATABASE cold")) {
+            qDebug() << "Failed to detach archive:" << detach.lastError().text();
+        }
+    }
+
+    QVector<TransactionRecord> hot = fetchFrom("transactions", from, to, filter);
+    if (records.isEmpty()) return hot;
+
+    // Unarchived old rows can still sit in the hot table, so restore global date order
+    records += hot;
+    std::stable_sort(records.begin(), records.end(), [](const TransactionRecord &a, const TransactionRecord &b) {
+        return a.date < b.date;
+    });
+    return records;
+}
+
+QVector<TransactionRecord> Database::fetchFrom(const QString &table, const QDate &from, const QDate &to, const SqlFilter *filter) {
+    // Archives frozen before currencies existed hold base-currency amounts only
+    QString currency = hasColumn(table, "currency") ? "currency" : "'EUR'";
+    bool filtered = filter && !filter->where.isEmpty();
+
+    // The inner select gives every source the same column names; SQLite flattens it, so the date index still applies
+    QSqlQuery query;
+    query.prepare(QString("SELECT id, date, category, description, amount, type, currency FROM "
+                          "(SELECT id, date, category, description, amount, type, %1 AS currency FROM %2) "
+                          "WHERE date >= ? AND date <= ?%3 ORDER BY date ASC")
+                      .arg(currency, table, filtered ? " AND " + filter->where : QString()));
+    query.addBindValue(from.isValid() ? from.toString("yyyy-MM-dd") : QString("0000-00-00"));
+    query.addBindValue(to.isValid() ? to.toString("yyyy-MM-dd") : QString("9999-99-99"));
+    if (filtered) {
+        for (const QVariant &value : filter->bindings) {
+            query.addBindValue(value);
+        }
+    }
+
+    QVector<TransactionRecord> records;
+    if (!query.exec()) {
+        qDebug() << "Failed to fetch transactions:" << query.lastError().text();
+        return records;
+    }
+
+    while (query.next()) {
+        records.append(recordFromQuery(query));
+    }
+
+    return records;
+}
+
+// Expects the columns id, date, category, description, amount, type, currency in that order
+TransactionRecord Database::recordFromQuery(const QSqlQuery &query) {
+    TransactionRecord record;
+    record.id = query.value(0).toInt();
+    record.date = QDate::fromString(query.value(1).toString(), "yyyy-MM-dd");
+    record.category = query.value(2).toString();
+    record.description = query.value(3).toString();
+    record.amount = query.value(4).toDouble();
+    record.type = query.value(5).toString();
+    record.currency = query.value(6).toString();
+    return record;
+}
+
+// Frozen archives are attached through a mode=ro URI, so SQLite itself refuses writes to them
+bool Database::attachPartition(const QString &path, const QString &alias) {
+    QUrl uri = QUrl::fromLocalFile(QFileInfo(path).absoluteFilePath());
+    uri.setQuery("mode=ro");
+
+    QSqlQuery attach;
+    attach.prepare(QString("ATTACH DATABASE ? AS %1").arg(alias));
+    attach.addBindValue(uri.toString(QUrl::FullyEncoded));
+    if (!attach.exec()) {
+        qDebug() << "Failed to attach archive" << path << ":" << attach.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QString Database::archivePath(int year) {
+    QFileInfo mainFile(QSqlDatabase::database().databaseName());
+    return mainFile.absoluteDir().filePath(QString("%1_%2.db").arg(mainFile.completeBaseName()).arg(year));
+}
+
+QList<int> Database::archivedYears() {
+    QList<int> years;
+    QSqlQuery query("SELECT year FROM partitions ORDER BY year");
+    while (query.next()) {
+        years.append(query.value(0).toInt());
+    }
+    return years;
+}
+
+// Moves a closed year out of the hot table into its own compacted, read-only database file
+bool Database::archiveYear(int year, int *archivedRows) {
+    if (year >= QDate::currentDate().year()) {
+        qDebug() << "Refusing to archive open year" << year;
+        return false;
+    }
+    if (archivedYears().contains(year)) {
+        qDebug() << "Year" << year << "is already archived";
+        return false;
+    }
+
+    QString path = archivePath(year);
+    if (QFile::exists(path)) {
+        qDebug() << "Archive file already exists:" << path;
+        return false;
+    }
+
+    QString from = QString("%1-01-01").arg(year);
+    QString to = QString("%1-12-31").arg(year);
+
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery query;
+    query.prepare("ATTACH DATABASE ? AS archive");
+    query.addBindValue(path);
+    if (!query.exec()) {
+        qDebug() << "Failed to create archive:" << query.lastError().text();
+        return false;
+    }
+
+    QString createArchive = R"(
+        CREATE TABLE archive.transactions (
+            id INTEGER PRIMARY KEY,
+            date TEXT NOT NULL,
+            category TEXT NOT NULL,
+            description TEXT,
+            amount REAL NOT NULL,
+            type TEXT NOT NULL,
+            currency TEXT NOT NULL DEFAULT 'EUR',
+            fingerprint INTEGER
+        )
+    )";
+
+    bool ok = db.transaction()
+              && query.exec(createArchive)
+              && query.prepare("INSERT INTO archive.transactions (id, date, category, description, amount, type, currency, fingerprint) "
+                               "SELECT id, date, category, description, amount, type, currency, fingerprint FROM main.transactions "
+                               "WHERE date >= ? AND date <= ? ORDER BY date");
+    if (ok) {
+        query.addBindValue(from);
+        query.addBindValue(to);
+        ok = query.exec();
+    }
+
+    int rows = ok ? query.numRowsAffected() : 0;
+
+    if (ok) {
+        ok = query.prepare("DELETE FROM main.transactions WHERE date >= ? AND date <= ?");
+        query.addBindValue(from);
+        query.addBindValue(to);
+        ok = ok && query.exec();
+    }
+
+    // Archiving is not spending: put back what the delete trigger took off the year's budget totals
+    if (ok) {
+        ok = query.prepare("UPDATE budgets SET spent = spent + COALESCE((SELECT SUM(amount) FROM archive.transactions a "
+                           "WHERE a.type = 'Expense' AND a.category = budgets.category AND substr(a.date, 1, 7) = budgets.month "
+                           "AND a.currency = budgets.currency), 0) "
+                           "WHERE month >= ? AND month <= ?");
+        query.addBindValue(QString("%1-01").arg(year));
+        query.addBindValue(QString("%1-12").arg(year));
+        ok = ok && query.exec();
+    }
+
+    if (ok) {
+        ok = query.prepare("INSERT INTO partitions (year, path, row_count, min_date, max_date, archived_at) "
+                           "SELECT ?, ?, COUNT(*), MIN(date), MAX(date), datetime('now') FROM archive.transactions");
+        query.addBindValue(year);
+        query.addBindValue(path);
+        ok = ok && query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "Failed to archive year" << year << ":" << query.lastError().text();
+        db.rollback();
+        query.exec("DETACH DATABASE archive");
+        QFile::remove(path);
+        return false;
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Failed to commit archive of" << year << ":" << db.lastError().text();
+        db.rollback();
+        query.exec("DETACH DATABASE archive");
+        QFile::remove(path);
+        return false;
+    }
+
+    // The rows are moved at this point; the steps below only tune and freeze the file, so a failure
+    // leaves a slower but complete archive and is logged rather than undone
+    if (!query.exec("CREATE INDEX archive.idx_archive_date ON transactions(date)")) {
+        qDebug() << "Failed to index archive" << path << ":" << query.lastError().text();
+    }
+    // Rows were appended in date order; rebuild the file tightly packed before freezing it
+    if (!query.exec("VACUUM archive")) {
+        qDebug() << "Failed to compact archive" << path << ":" << query.lastError().text();
+    }
+    if (!query.exec("DETACH DATABASE archive")) {
+        qDebug() << "Failed to detach archive" << path << ":" << query.lastError().text();
+    }
+
+    if (!QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::ReadGroup | QFileDevice::ReadOther)) {
+        qDebug() << "Failed to make archive read-only:" << path;
+    }
+
+    if (archivedRows) *archivedRows = rows;
+    qDebug() << "Archived" << rows << "transactions from" << year << "to" << path;
+    return true;
+}
+
+bool Database::fetchTransaction(int id, TransactionRecord *record) {
+    QSqlQuery query;
+    query.prepare("SELECT id, date, category, description, amount, type, currency FROM transactions WHERE id = ?");
+    query.addBindValue(id);
+
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+
+    *record = recordFromQuery(query);
+    return true;
+}
+
+int Database::transactionCount() {
+    QSqlQuery query("SELECT COUNT(*) FROM transactions");
+    if (!query.next()) {
+        qDebug() << "Failed to count transactions:" << query.lastError().text();
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+
+QVector<TransactionRecord> Database::queryTransactions(const SqlFilter *filter, int limit, int offset) {
+    bool filtered = filter && !filter->where.isEmpty();
+
+    // id breaks date ties so consecutive pages neither repeat nor skip rows
+    QSqlQuery query;
+    query.prepare(QString("SELECT id, date, category, description, amount, type, currency FROM transactions%1 "
+                          "ORDER BY date DESC, id DESC LIMIT ? OFFSET ?")
+                      .arg(filtered ? " WHERE " + filter->where : QString()));
+    if (filtered) {
+        for (const QVariant &value : filter->bindings) {
+            query.addBindValue(value);
+        }
+    }
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+
+    QVector<TransactionRecord> records;
+    if (!query.exec()) {
+        qDebug() << "Failed to query transactions:" << query.lastError().text();
+        return records;
+    }
+
+    while (query.next()) {
+        records.append(recordFromQuery(query));
+    }
+
+    return records;
+}
+
+// Per-day income/expense of the hot partition; the aggregation runs in SQLite over the date index
+// One row per (date, currency) in native amounts; FxConverter::convertDailyTotals folds them into one currency
+QVector<DailyTotal> Database::dailyTotals() {
+    QSqlQuery query("SELECT date, "
+                    "SUM(CASE WHEN type = 'Income' THEN amount ELSE 0 END), "
+                    "SUM(CASE WHEN type = 'Income' THEN 0 ELSE amount END), "
+                    "currency "
+                    "FROM transactions GROUP BY date, currency ORDER BY date, currency");
+
+    QVector<DailyTotal> totals;
+    while (query.next()) {
+        DailyTotal total;
+        total.date = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
+        if (!total.date.isValid()) continue;
+        total.income = query.value(1).toDouble();
+        total.expense = query.value(2).toDouble();
+        total.currency = query.value(3).toString();
+        totals.append(total);
+    }
+
+    return totals;
+}
+
+QVector<DailyTotal> Database::archivedTotals() {
+    QList<QPair<QString, QString>> partitions;
+    QSqlQuery list("SELECT path, max_date FROM partitions ORDER BY year");
+    while (list.next()) {
+        partitions.append(qMakePair(list.value(0).toString(), list.value(1).toString()));
+    }
+
+    QVector<DailyTotal> totals;
+    for (const auto &partition : partitions) {
+        if (!attachPartition(partition.first, "cold")) continue;
+
+        QString currency = hasColumn("cold.transactions", "currency") ? "currency" : "'EUR'";
+        QSqlQuery query(QString("SELECT SUM(CASE WHEN type = 'Income' THEN amount ELSE 0 END), "
+                                "SUM(CASE WHEN type = 'Income' THEN 0 ELSE amount END), "
+                                "%1 AS cur FROM cold.transactions GROUP BY cur ORDER BY cur")
+                            .arg(currency));
+        if (!query.isActive()) {
+            qDebug() << "Failed to total archive" << partition.first << ":" << query.lastError().text();
+        }
+        while (query.next()) {
+            DailyTotal total;
+            total.date = QDate::fromString(partition.second, "yyyy-MM-dd");
+            total.income = query.value(0).toDouble();
+            total.expense = query.value(1).toDouble();
+            total.currency = query.value(2).toString();
+            totals.append(total);
+        }
+        query.finish();
+
+        QSqlQuery detach;
+        if (!detach.exec("DETACH DATABASE cold")) {
+            qDebug() << "Failed to detach archive:" << detach.lastError().text();
+        }
+    }
+    return totals;
+}
+
+// Bumped by SQLite whenever another connection commits to the database file
+qint64 Database::dataVersion() {
+    QSqlQuery query("PRAGMA data_version");
+    return query.next() ? query.value(0).toLongLong() : -1;
+}
+
+qint64 Database::latestChangeSeq() {
+    QSqlQuery query("SELECT COALESCE(MAX(seq), 0) FROM changes");
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+qint64 Database::oldestChangeSeq() {
+    QSqlQuery query("SELECT COALESCE(MIN(seq), 0) FROM changes");
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+QVector<ChangeEntry> Database::changesSince(qint64 seq) {
+    QSqlQuery query;
+    query.prepare("SELECT seq, op, row_id FROM changes WHERE seq > ? ORDER BY seq");
+    query.addBindValue(seq);
+
+    QVector<ChangeEntry> entries;
+    if (!query.exec()) {
+        qDebug() << "Failed to read change log:" << query.lastError().text();
+        return entries;
+    }
+
+    while (query.next()) {
+        ChangeEntry entry;
+        entry.seq = query.value(0).toLongLong();
+        entry.op = query.value(1).toString();
+        entry.rowId = query.value(2).toInt();
+        entries.append(entry);
+    }
+
+    return entries;
+}
+
+// Readers that fall behind the compacted log detect the gap and reload fully
+bool Database::compactChanges(int keepDays) {
+    QSqlQuery query;
+    query.prepare("DELETE FROM changes WHERE changed_at < datetime('now', ?)");
+    query.addBindValue(QString("-%1 days").arg(keepDays));
+
+    if (!query.exec()) {
+        qDebug() << "Failed to compact change log:" << query.lastError().text();
+        return false;
+    }
+
+    if (query.numRowsAffected() > 0) {
+        qDebug() << "Compacted" << query.numRowsAffected() << "change log entries";
+    }
+    return true;
+}
+
+QHash<QString, double> Database::budgetSpent(const QString &category, const QString &month) {
+    QHash<QString, double> spent;
+    QSqlQuery query;
+    query.prepare("SELECT currency, spent FROM budgets WHERE category = ? AND month = ?");
+    query.addBindValue(category);
+    query.addBindValue(month);
+    if (query.exec()) {
+        while (query.next()) {
+            spent.insert(query.value(0).toString(), query.value(1).toDouble());
+        }
+    }
+    return spent;
+}
+
+QHash<QString, double> Database::budgetLimits() {
+    QHash<QString, double> limits;
+    QSqlQuery query("SELECT category, monthly_limit FROM budget_limits");
+    while (query.next()) {
+        limits.insert(query.value(0).toString(), query.value(1).toDouble());
+    }
+    return limits;
+}
+
+bool Database::setBudgetLimit(const QString &category, double monthlyLimit) {
+    QSqlQuery query;
+    if (monthlyLimit <= 0) {
+        query.prepare("DELETE FROM budget_limits WHERE category = ?");
+        query.addBindValue(category);
+    } else {
+        query.prepare("INSERT OR REPLACE INTO budget_limits (category, monthly_limit) VALUES (?, ?)");
+        query.addBindValue(category);
+        query.addBindValue(monthlyLimit);
+    }
+
+    if (!query.exec()) {
+        qDebug() << "Failed to set budget limit:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+QSqlQuery Database::getBudgetTotals() {
+    QSqlQuery query("SELECT category, month, currency, spent FROM budgets");
+    return query;
+}
+
+// Loads "date,currency,rate" lines (rate = EUR per unit of currency); returns the number of rates stored or -1
+int Database::importFxRates(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Failed to open rate file:" << path;
+        return -1;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QSqlQuery query;
+    query.prepare("INSERT OR REPLACE INTO fx_rates (currency, date, rate) VALUES (?, ?, ?)");
+
+    int imported = 0;
+    while (!file.atEnd()) {
+        QStringList fields = QString::fromUtf8(file.readLine()).trimmed().split(',');
+        if (fields.size() < 3) continue;
+
+        QDate date = QDate::fromString(fields[0].trimmed(), "yyyy-MM-dd");
+        bool ok;
+        double rate = fields[2].trimmed().toDouble(&ok);
+        if (!date.isValid() || !ok || rate <= 0) continue;  // Header and malformed lines
+
+        query.addBindValue(fields[1].trimmed().toUpper());
+        query.addBindValue(date.toString("yyyy-MM-dd"));
+        query.addBindValue(rate);
+        if (!query.exec()) {
+            qDebug() << "Failed to import rate:" << query.lastError().text();
+            db.rollback();
+            return -1;
+        }
+        imported++;
+    }
+
+    db.commit();
+    qDebug() << "Imported" << imported << "FX rates from" << path;
+    return imported;
+}
+
+QSqlQuery Database::getFxRates() {
+    QSqlQuery query("SELECT currency, date, rate FROM fx_rates ORDER BY currency, date");
     return query;
-}
\ No newline at end of file
+}
+
+QVector<RecurringRule> Database::recurringRules() {
+    QVector<RecurringRule> rules;
+    QSqlQuery query("SELECT id, description, category, amount, type, currency, start_date, rrule, materialized_through "
+                    "FROM recurring_rules ORDER BY id");
+    while (query.next()) {
+        RecurringRule rule;
+        rule.id = query.value(0).toInt();
+        rule.description = query.value(1).toString();
+        rule.category = query.value(2).toString();
+        rule.amount = query.value(3).toDouble();
+        rule.type = query.value(4).toString();
+        rule.currency = query.value(5).toString();
+        rule.startDate = QDate::fromString(query.value(6).toString(), "yyyy-MM-dd");
+        rule.rrule = query.value(7).toString();
+        rule.materializedThrough = QDate::fromString(query.value(8).toString(), "yyyy-MM-dd");
+        rules.append(rule);
+    }
+    return rules;
+}
+
+bool Database::addRecurringRule(const RecurringRule &rule) {
+    QSqlQuery query;
+    query.prepare("INSERT INTO recurring_rules (description, category, amount, type, currency, start_date, rrule) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(rule.description);
+    query.addBindValue(rule.category);
+    query.addBindValue(rule.amount);
+    query.addBindValue(rule.type);
+    query.addBindValue(rule.currency);
+    query.addBindValue(rule.startDate.toString("yyyy-MM-dd"));
+    query.addBindValue(rule.rrule);
+
+    if (!query.exec()) {
+        qDebug() << "Failed to add recurring rule:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+bool Database::deleteRecurringRule(int id) {
+    QSqlQuery query;
+    query.prepare("DELETE FROM recurring_rules WHERE id = ?");
+    query.addBindValue(id);
+
+    if (!query.exec()) {
+        qDebug() << "Failed to delete recurring rule:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+bool Database::materializeRule(int ruleId, const QDate &previousThrough, const QDate &through, const QVector<TransactionRecord> &records) {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start materializing recurring rule" << ruleId << ":" << db.lastError().text();
+        return false;
+    }
+
+    // Advancing the marker first acts as a compare-and-swap between processes sharing the database
+    QSqlQuery advance;
+    advance.prepare("UPDATE recurring_rules SET materialized_through = ? WHERE id = ? AND COALESCE(materialized_through, '') = ?");
+    advance.addBindValue(through.toString("yyyy-MM-dd"));
+    advance.addBindValue(ruleId);
+    advance.addBindValue(previousThrough.isValid() ? previousThrough.toString("yyyy-MM-dd") : QString(""));
+
+    if (!advance.exec() || advance.numRowsAffected() != 1) {
+        qDebug() << "Recurring rule" << ruleId << "was not advanced:" << advance.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    for (const TransactionRecord &record : records) {
+        if (!addTransaction(record.date.toString("yyyy-MM-dd"), record.category, record.description, record.amount,
+                            record.type, record.currency)) {
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Failed to commit recurring rule" << ruleId << ":" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
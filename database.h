@@ -4,14 +4,119 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QString>
+#include <QDate>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QVariantList>
+
+struct TransactionRecord {
+    int id = -1;
+    QDate date;
+    QString category;
+    QString description;
+    double amount = 0.0;
+    QString type;
+    QString currency = "EUR";
+};
+
+// A parameterized WHERE clause over the transactions columns
+struct SqlFilter {
+    QString where;          // empty when the filter matches everything
+    QVariantList bindings;  // positional, in the order of the placeholders
+};
+
+struct DailyTotal {
+    QDate date;
+    double income = 0.0;
+    double expense = 0.0;
+    QString currency = "EUR";
+};
+
+struct ChangeEntry {
+    qint64 seq = 0;
+    QString op;   // "insert", "update" or "delete"
+    int rowId = -1;
+};
+
+// A repeating transaction. The schedule is an RRULE subset (FREQ, INTERVAL, COUNT, UNTIL, BYMONTHDAY)
+// anchored at startDate; rows up to materializedThrough already exist in transactions.
+struct RecurringRule {
+    int id = -1;
+    QString description;
+    QString category;
+    double amount = 0.0;
+    QString type;
+    QString currency = "EUR";
+    QDate startDate;
+    QString rrule;
+    QDate materializedThrough;
+};
 
 class Database {
 public:
-    static bool initialize();
-    static bool addTransaction(const QString &date, const QString &category, const QString &description, double amount, const QString &type);
+    static bool initialize(const QString &path = "finance_tracker.db");
+    static bool addTransaction(const QString &date, const QString &category, const QString &description, double amount, const QString &type, const QString &currency = "EUR");
     static QSqlQuery getAllTransactions();
-    static bool updateTransaction(int id, const QString &date, const QString &category, const QString &description, double amount, const QString &type);  
+    static bool updateTransaction(int id, const QString &date, const QString &category, const QString &description, double amount, const QString &type, const QString &currency = "EUR");  
     static bool deleteTransaction(int id);  
+    // Inserts with the record's own id; a no-op when that id already exists, so journal replay is idempotent
+    static bool insertTransaction(const TransactionRecord &record);
+    // Bumps the AUTOINCREMENT high-water mark so other writers never hand out these ids; returns the first, or -1
+    static int reserveTransactionIds(int count);
+    // One journal per running process; slot 0 keeps the original file name
+    static QString journalPath(int slot = 0);
+    static quint64 fingerprint(const QString &date, double amount, const QString &type, const QString &description, const QString &currency);
+    // Looks in the hot table and, when the date's year is archived, in that year's partition
+    static int findDuplicate(const QString &date, double amount, const QString &type, const QString &description, const QString &currency,
+                             int excludeId = -1);
+    static QVector<TransactionRecord> fetchTransactions(const QDate &from, const QDate &to, const SqlFilter *filter = nullptr);
+    static bool archiveYear(int year, int *archivedRows = nullptr);
+    static QList<int> archivedYears();
+    static bool fetchTransaction(int id, TransactionRecord *record);
+    static QVector<DailyTotal> dailyTotals();
+    // Income and expense of each archived year, one row per year and currency dated at the year's last row
+    static QVector<DailyTotal> archivedTotals();
+    static int transactionCount();
+    // Newest rows of the hot partition matching the filter, skipping the first offset; a negative limit returns them all
+    static QVector<TransactionRecord> queryTransactions(const SqlFilter *filter, int limit = -1, int offset = 0);
+
+    // Cross-process change tracking
+    static qint64 dataVersion();
+    static qint64 latestChangeSeq();
+    static qint64 oldestChangeSeq();
+    static QVector<ChangeEntry> changesSince(qint64 seq);
+    static bool compactChanges(int keepDays = 1);
+
+    // Budgets
+    static QSqlQuery getBudgetTotals();
+    // Native-currency totals for one (category, month), keyed by currency
+    static QHash<QString, double> budgetSpent(const QString &category, const QString &month);
+    static QHash<QString, double> budgetLimits();
+    static bool setBudgetLimit(const QString &category, double monthlyLimit);
+
+    // Currencies
+    static int importFxRates(const QString &path);
+    static QSqlQuery getFxRates();
+
+    // Recurring rules
+    static QVector<RecurringRule> recurringRules();
+    static bool addRecurringRule(const RecurringRule &rule);
+    static bool deleteRecurringRule(int id);
+    // Inserts the due occurrences and advances the rule in one transaction; fails if another process got there first
+    static bool materializeRule(int ruleId, const QDate &previousThrough, const QDate &through, const QVector<TransactionRecord> &records);
+
+private:
+    // Bump when the fingerprint recipe changes; initialize() then recomputes every stored hash
+    static const int FingerprintVersion = 2;
+
+    static bool hasColumn(const QString &table, const QString &column);
+    static bool backfillFingerprints();
+    static bool initializeBudgets();
+    static QString archivePath(int year);
+    static bool attachPartition(const QString &path, const QString &alias);
+    static TransactionRecord recordFromQuery(const QSqlQuery &query);
+    static QVector<TransactionRecord> fetchFrom(const QString &table, const QDate &from, const QDate &to, const SqlFilter *filter);
 };
 
 #endif 
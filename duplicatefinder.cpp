@@ -0,0 +1,54 @@
+#include "duplicatefinder.h"
+#include <QHash>
+#include <algorithm>
+
+QVector<DuplicatePair> DuplicateFinder::findNearDuplicates(const QVector<TransactionRecord> &records, int windowDays) {
+    // Same cents, type and currency hash to the same bucket; the description is compared only inside a bucket
+    QHash<QPair<qint64, QString>, QVector<int>> buckets;
+    for (int i = 0; i < records.size(); ++i) {
+        const TransactionRecord &record = records[i];
+        buckets[qMakePair(qRound64(record.amount * 100), record.type.toLower() + '|' + record.currency)].append(i);
+    }
+
+    QVector<DuplicatePair> pairs;
+    for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+        QVector<int> &bucket = it.value();
+        if (bucket.size() < 2) continue;
+
+        std::sort(bucket.begin(), bucket.end(), [&](int a, int b) {
+            return records[a].date < records[b].date;
+        });
+
+        // Sliding window: each row is compared only with later rows inside the date window
+        for (int i = 0; i < bucket.size(); ++i) {
+            const TransactionRecord &current = records[bucket[i]];
+            for (int j = i + 1; j < bucket.size(); ++j) {
+                const TransactionRecord &other = records[bucket[j]];
+                int gap = current.date.daysTo(other.date);
+                if (gap > windowDays) break;
+
+                if (!similarDescriptions(current.description, other.description)) continue;
+
+                DuplicatePair pair;
+                pair.first = current;
+                pair.second = other;
+                pair.dayGap = gap;
+                pair.exact = gap == 0 && current.description.simplified().compare(other.description.simplified(), Qt::CaseInsensitive) == 0;
+                pairs.append(pair);
+            }
+        }
+    }
+
+    return pairs;
+}
+
+bool DuplicateFinder::similarDescriptions(const QString &a, const QString &b) {
+    QString left = a.simplified().toLower();
+    QString right = b.simplified().toLower();
+
+    if (left == right) return true;
+    if (left.isEmpty() || right.isEmpty()) return false;
+
+    // Bank statements often append references ("NETFLIX" vs "NETFLIX 4829")
+    return left.startsWith(right) || right.startsWith(left);
+}
@@ -0,0 +1,23 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <QVector>
+#include "database.h"
+
+struct DuplicatePair {
+    TransactionRecord first;
+    TransactionRecord second;
+    int dayGap = 0;
+    bool exact = false;
+};
+
+class DuplicateFinder {
+public:
+    // Buckets rows by (amount, type, currency) and only compares rows whose dates fall within windowDays of each other
+    static QVector<DuplicatePair> findNearDuplicates(const QVector<TransactionRecord> &records, int windowDays = 3);
+
+private:
+    static bool similarDescriptions(const QString &a, const QString &b);
+};
+
+#endif
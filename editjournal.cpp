@@ -0,0 +1,327 @@
+#include "editjournal.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+JournalEntry JournalEntry::inverse() const {
+    JournalEntry entry;
+    switch (kind) {
+    case Add:
+        entry.kind = Remove;
+        entry.before = after;
+        break;
+    case Update:
+        entry.kind = Update;
+        entry.before = after;
+        entry.after = before;
+        break;
+    case Remove:
+        entry.kind = Add;
+        entry.after = before;
+        break;
+    }
+    return entry;
+}
+
+EditJournal::EditJournal(QObject *parent)
+    : QObject(parent) {
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(GroupCommitIntervalMs);
+    connect(&flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+}
+
+EditJournal::~EditJournal() {
+    flush();
+}
+
+bool EditJournal::open() {
+    for (int slot = 0; slot < MaxJournals; ++slot) {
+        QString path = Database::journalPath(slot);
+
+        // A live process holds its journal's lock; the lock of a process that died is stale and taken over
+        QScopedPointer<QLockFile> slotLock(new QLockFile(path + ".lock"));
+        slotLock->setStaleLockTime(0);
+        if (!slotLock->tryLock(0)) continue;
+
+        QFile journal(path);
+        if (journal.exists() && !replay(journal)) {
+            // The entries stay on disk for the next start; this slot is not ours to append to
+            if (!lock.isNull()) continue;
+            return false;
+        }
+
+        if (lock.isNull()) {
+            lock.swap(slotLock);
+            file.setFileName(path);
+        } else {
+            journal.remove();
+        }
+    }
+
+    if (lock.isNull()) {
+        qDebug() << "Every journal slot is held by another process";
+        return false;
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open journal:" << file.errorString();
+        return false;
+    }
+    return file.resize(0) && syncFile();
+}
+
+// Applies the entries of a journal we hold the lock for, then empties it
+bool EditJournal::replay(QFile &journal) {
+    if (!journal.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to read journal:" << journal.errorString();
+        return false;
+    }
+
+    QVector<JournalEntry> leftover;
+    while (!journal.atEnd()) {
+        QByteArray line = journal.readLine().trimmed();
+        if (line.isEmpty()) continue;
+
+        // A torn last line was never synced, so it was never acknowledged either
+        JournalEntry entry;
+        if (!deserialize(line, &entry)) {
+            qDebug() << "Skipping unreadable journal entry";
+            continue;
+        }
+        leftover.append(entry);
+    }
+    journal.close();
+
+    // Replay is idempotent, so a crash between the group commit and the truncate is harmless.
+    // On failure the file stays as it is for the next start.
+    if (!leftover.isEmpty()) {
+        if (!applyAll(leftover)) return false;
+        qDebug() << "Replayed" << leftover.size() << "entries from" << journal.fileName();
+    }
+    return journal.resize(0);
+}
+
+int EditJournal::allocateId() {
+    if (nextId >= reservedEnd) {
+        int first = Database::reserveTransactionIds(IdBlockSize);
+        if (first == -1) return -1;
+        nextId = first;
+        reservedEnd = first + IdBlockSize;
+    }
+    return nextId++;
+}
+
+bool EditJournal::record(const JournalEntry &entry) {
+    if (!append(entry)) return false;
+
+    undoStack.append(entry);
+    if (undoStack.size() > UndoDepth) undoStack.removeFirst();
+    redoStack.clear();
+    emit undoStateChanged(canUndo(), canRedo());
+    return true;
+}
+
+bool EditJournal::undo(JournalEntry *applied) {
+    if (undoStack.isEmpty()) return false;
+
+    JournalEntry entry = undoStack.last().inverse();
+    if (!append(entry)) return false;
+
+    redoStack.append(undoStack.takeLast());
+    *applied = entry;
+    emit undoStateChanged(canUndo(), canRedo());
+    return true;
+}
+
+bool EditJournal::redo(JournalEntry *applied) {
+    if (redoStack.isEmpty()) return false;
+
+    JournalEntry entry = redoStack.last();
+    if (!append(entry)) return false;
+
+    undoStack.append(redoStack.takeLast());
+    *applied = entry;
+    emit undoStateChanged(canUndo(), canRedo());
+    return true;
+}
+
+bool EditJournal::append(const JournalEntry &entry) {
+    if (!file.isOpen()) {
+        qDebug() << "Journal is not open";
+        return false;
+    }
+
+    QByteArray line = serialize(entry);
+    if (file.write(line) != line.size() || !syncFile()) {
+        qDebug() << "Failed to write journal:" << file.errorString();
+        return false;
+    }
+
+    pending.append(entry);
+    if (pending.size() >= GroupCommitSize) {
+        flush();
+    } else if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+    return true;
+}
+
+bool EditJournal::flush() {
+    flushTimer.stop();
+    if (pending.isEmpty()) return true;
+
+    // Entries stay pending and in the file until SQLite has them; the timer retries
+    if (!applyAll(pending)) {
+        flushTimer.start();
+        return false;
+    }
+
+    int count = pending.size();
+    pending.clear();
+    file.resize(0);
+    syncFile();
+
+    emit flushed(count);
+    return true;
+}
+
+int EditJournal::findDuplicate(const QString &date, double amount, const QString &type, const QString &description,
+                               const QString &currency) const {
+    // Final pending state per id; removed rows map to null
+    QHash<int, const TransactionRecord *> latest;
+    for (const JournalEntry &entry : pending) {
+        latest.insert(entry.id(), entry.kind == JournalEntry::Remove ? nullptr : &entry.after);
+    }
+
+    quint64 wanted = Database::fingerprint(date, amount, type, description, currency);
+    for (auto it = latest.constBegin(); it != latest.constEnd(); ++it) {
+        const TransactionRecord *record = it.value();
+        if (record && Database::fingerprint(record->date.toString("yyyy-MM-dd"), record->amount, record->type,
+                                            record->description, record->currency) == wanted) {
+            return it.key();
+        }
+    }
+
+    // A stored match that a pending edit changes or removes is not a duplicate any more
+    int id = Database::findDuplicate(date, amount, type, description, currency);
+    return latest.contains(id) ? -1 : id;
+}
+
+bool EditJournal::applyAll(const QVector<JournalEntry> &entries) {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        qDebug() << "Failed to start the journal group commit:" << db.lastError().text();
+        return false;
+    }
+
+    for (const JournalEntry &entry : entries) {
+        if (!apply(entry)) {
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Failed to commit journal entries";
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool EditJournal::apply(const JournalEntry &entry) {
+    const TransactionRecord &record = entry.after;
+    switch (entry.kind) {
+    case JournalEntry::Add:
+        return Database::insertTransaction(record);
+    case JournalEntry::Update:
+        return Database::updateTransaction(record.id, record.date.toString("yyyy-MM-dd"), record.category, record.description,
+                                           record.amount, record.type, record.currency);
+    case JournalEntry::Remove:
+        return Database::deleteTransaction(entry.before.id);
+    }
+    return false;
+}
+
+// One compact JSON object per line. Replay only needs the new state, so before is not written.
+QByteArray EditJournal::serialize(const JournalEntry &entry) {
+    static const char *kinds[] = {"add", "update", "delete"};
+
+    QJsonObject object;
+    object["op"] = kinds[entry.kind];
+    object["id"] = entry.id();
+    if (entry.kind != JournalEntry::Remove) {
+        object["date"] = entry.after.date.toString("yyyy-MM-dd");
+        object["category"] = entry.after.category;
+        object["description"] = entry.after.description;
+        object["amount"] = entry.after.amount;
+        object["type"] = entry.after.type;
+        object["currency"] = entry.after.currency;
+    }
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool EditJournal::deserialize(const QByteArray &line, JournalEntry *entry) {
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(line, &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) return false;
+
+    QJsonObject object = document.object();
+    QString op = object["op"].toString();
+    int id = object["id"].toInt(-1);
+    if (id < 0) return false;
+
+    if (op == "delete") {
+        entry->kind = JournalEntry::Remove;
+        entry->before.id = id;
+        return true;
+    }
+
+    if (op == "add") {
+        entry->kind = JournalEntry::Add;
+    } else if (op == "update") {
+        entry->kind = JournalEntry::Update;
+    } else {
+        return false;
+    }
+
+    TransactionRecord &record = entry->after;
+    record.id = id;
+    record.date = QDate::fromString(object["date"].toString(), "yyyy-MM-dd");
+    record.category = object["category"].toString();
+    record.description = object["description"].toString();
+    record.amount = object["amount"].toDouble();
+    record.type = object["type"].toString();
+    record.currency = object["currency"].toString("EUR");
+    return record.date.isValid();
+}
+
+bool EditJournal::syncFile() {
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+qint64 EditJournal::memoryUsage() const {
+    qint64 bytes = 0;
+    for (const QVector<JournalEntry> *entries : {&pending, &undoStack, &redoStack}) {
+        bytes += entries->capacity() * sizeof(JournalEntry);
+        for (const JournalEntry &entry : *entries) {
+            for (const TransactionRecord *record : {&entry.before, &entry.after}) {
+                bytes += (record->category.capacity() + record->description.capacity() + record->type.capacity()
+                          + record->currency.capacity()) * sizeof(QChar);
+            }
+        }
+    }
+    return bytes;
+}
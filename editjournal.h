@@ -0,0 +1,88 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QLockFile>
+#include <QScopedPointer>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+#include "database.h"
+
+// One reversible ledger edit. Update and Remove keep the prior row so the edit can be inverted.
+struct JournalEntry {
+    enum Kind { Add = 0, Update = 1, Remove = 2 };
+
+    Kind kind = Add;
+    TransactionRecord before;  // Update, Remove
+    TransactionRecord after;   // Add, Update
+
+    int id() const { return kind == Remove ? before.id : after.id; }
+    JournalEntry inverse() const;
+};
+
+// Write-behind journal for form edits. An edit is acknowledged once it is
+// appended and synced to the journal file; SQLite sees it later in one group
+// commit per interval or batch. Leftover entries are replayed on open, and
+// undo/redo journal the inverse edit like any other. Each process holds a
+// lock on its own journal file for its lifetime; journals whose lock is free
+// were left by a process that stopped, and are replayed by the next one.
+class EditJournal : public QObject {
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QObject *parent = nullptr);
+    ~EditJournal() override;
+
+    // Replays entries that stopped processes left behind, then locks a journal of our own for appending
+    bool open();
+
+    // Ids come from blocks reserved in SQLite, so adds get their final id before they are flushed
+    int allocateId();
+
+    bool record(const JournalEntry &entry);
+    bool undo(JournalEntry *applied);
+    bool redo(JournalEntry *applied);
+    bool canUndo() const { return !undoStack.isEmpty(); }
+    bool canRedo() const { return !redoStack.isEmpty(); }
+
+    int pendingCount() const { return pending.size(); }
+    bool flush();
+
+    // Database::findDuplicate as the ledger will look once pending edits are flushed; -1 when none
+    int findDuplicate(const QString &date, double amount, const QString &type, const QString &description,
+                      const QString &currency) const;
+
+    qint64 memoryUsage() const;
+
+    static constexpr int GroupCommitSize = 50;
+    static constexpr int GroupCommitIntervalMs = 2000;
+    static constexpr int UndoDepth = 100;
+    static constexpr int IdBlockSize = 100;
+    static constexpr int MaxJournals = 16;
+
+signals:
+    void flushed(int count);
+    void undoStateChanged(bool canUndo, bool canRedo);
+
+private:
+    bool append(const JournalEntry &entry);
+    bool replay(QFile &journal);
+    bool applyAll(const QVector<JournalEntry> &entries);
+    static bool apply(const JournalEntry &entry);
+    static QByteArray serialize(const JournalEntry &entry);
+    static bool deserialize(const QByteArray &line, JournalEntry *entry);
+    bool syncFile();
+
+    QFile file;
+    QScopedPointer<QLockFile> lock;
+    QTimer flushTimer;
+    QVector<JournalEntry> pending;
+    QVector<JournalEntry> undoStack;
+    QVector<JournalEntry> redoStack;
+    int nextId = 0;
+    int reservedEnd = 0;  // one past the last reserved id
+};
+
+#endif
@@ -0,0 +1,543 @@
+#include "filterexpression.h"
+#include <QDebug>
+
+void LedgerColumns::clear() {
+    *this = LedgerColumns();
+}
+
+namespace {
+
+int dictionaryId(QHash<QString, int> &index, QStringList &names, const QString &value) {
+    QString key = FilterExpression::foldCase(value);
+    auto it = index.constFind(key);
+    if (it != index.constEnd()) return it.value();
+    int id = names.size();
+    index.insert(key, id);
+    names.append(key);
+    return id;
+}
+
+}
+
+void LedgerColumns::append(const TransactionRecord &record) {
+    ids.append(record.id);
+    days.append(record.date.toJulianDay());
+    amounts.append(record.amount);
+    categories.append(dictionaryId(categoryIndex, categoryNames, record.category));
+    types.append(dictionaryId(typeIndex, typeNames, record.type));
+    currencies.append(dictionaryId(currencyIndex, currencyNames, record.currency));
+    descriptions.append(FilterExpression::foldCase(record.description));
+}
+
+qint64 LedgerColumns::memoryUsage() const {
+    qint64 bytes = ids.capacity() * sizeof(int) + days.capacity() * sizeof(qint64) + amounts.capacity() * sizeof(double)
+                   + (categories.capacity() + types.capacity() + currencies.capacity()) * sizeof(int)
+                   + descriptions.capacity() * sizeof(QString);
+    for (const QString &description : descriptions) {
+        bytes += description.capacity() * sizeof(QChar);
+    }
+    for (const QStringList *names : {&categoryNames, &typeNames, &currencyNames}) {
+        for (const QString &name : *names) {
+            bytes += sizeof(QString) + name.capacity() * sizeof(QChar) + 32;  // plus the index hash node
+        }
+    }
+    return bytes;
+}
+
+LedgerColumns LedgerColumns::fromRecords(const QVector<TransactionRecord> &records) {
+    LedgerColumns columns;
+    for (const TransactionRecord &record : records) {
+        columns.append(record);
+    }
+    return columns;
+}
+
+// ================= PARSER =================
+
+// Recursive descent over a token list, emitting the postfix program directly
+class FilterParser {
+public:
+    FilterParser(const QString &text, FilterExpression *target) : input(text), expression(target) {}
+
+    bool parse(QString *error) {
+        if (!tokenize()) {
+            if (error) *error = message;
+            return false;
+        }
+
+        if (!tokens.isEmpty()) {
+            parseOr();
+            if (ok && pos < tokens.size()) fail(QString("Unexpected '%1'").arg(tokens[pos].text));
+        }
+
+        if (!ok && error) *error = message;
+        return ok;
+    }
+
+private:
+    struct Token {
+        enum Kind { Word, String, Symbol } kind;
+        QString text;
+    };
+
+    bool tokenize() {
+        int i = 0;
+        while (i < input.size()) {
+            QChar c = input[i];
+            if (c.isSpace()) {
+                i++;
+            } else if (c == '"') {
+                QString value;
+                i++;
+                while (i < input.size() && input[i] != '"') {
+                    if (input[i] == '\\' && i + 1 < input.size()) i++;
+                    value += input[i++];
+                }
+                if (i >= input.size()) return fail("Unterminated string");
+                i++;
+                tokens.append({Token::String, value});
+            } else if (QString("(),~").contains(c)) {
+                tokens.append({Token::Symbol, QString(c)});
+                i++;
+            } else if (QString("=!<>").contains(c)) {
+                QString symbol(c);
+                if (i + 1 < input.size() && input[i + 1] == '=') symbol += input[++i];
+                if (symbol == "!") return fail("Expected '!='");
+                tokens.append({Token::Symbol, symbol == "==" ? QString("=") : symbol});
+                i++;
+            } else {
+                int start = i;
+                while (i < input.size() && !input[i].isSpace() && !QString("(),~=!<>\"").contains(input[i])) i++;
+                tokens.append({Token::Word, input.mid(start, i - start)});
+            }
+        }
+        return true;
+    }
+
+    bool fail(const QString &text) {
+        if (ok) message = text;
+        ok = false;
+        return false;
+    }
+
+    bool atKeyword(const char *keyword) const {
+        return pos < tokens.size() && tokens[pos].kind == Token::Word && tokens[pos].text.compare(keyword, Qt::CaseInsensitive) == 0;
+    }
+
+    bool atSymbol(const char *symbol) const {
+        return pos < tokens.size() && tokens[pos].kind == Token::Symbol && tokens[pos].text == symbol;
+    }
+
+    void emitOp(FilterExpression::Op op) {
+        FilterExpression::Instruction instruction;
+        instruction.op = op;
+        expression->program.append(instruction);
+    }
+
+    void parseOr() {
+        parseAnd();
+        while (ok && atKeyword("or")) {
+            pos++;
+            parseAnd();
+            emitOp(FilterExpression::Or);
+        }
+    }
+
+    void parseAnd() {
+        parseUnary();
+        while (ok && atKeyword("and")) {
+            pos++;
+            parseUnary();
+            emitOp(FilterExpression::And);
+        }
+    }
+
+    void parseUnary() {
+        if (atKeyword("not")) {
+            pos++;
+            parseUnary();
+            emitOp(FilterExpression::Not);
+        } else if (atSymbol("(")) {
+            pos++;
+            parseOr();
+            if (ok && !atSymbol(")")) fail("Expected ')'");
+            pos++;
+        } else {
+            parseComparison();
+        }
+    }
+
+    QString takeValue() {
+        if (pos >= tokens.size() || tokens[pos].kind == Token::Symbol) {
+            fail("Expected a value");
+            return QString();
+        }
+        return tokens[pos++].text;
+    }
+
+    void parseComparison() {
+        static const QHash<QString, FilterExpression::Field> fields = {
+            {"date", FilterExpression::Date}, {"amount", FilterExpression::Amount},
+            {"category", FilterExpression::Category}, {"desc", FilterExpression::Description},
+            {"description", FilterExpression::Description}, {"type", FilterExpression::Type},
+            {"currency", FilterExpression::Currency}
+        };
+        static const QHash<QString, FilterExpression::Op> operators = {
+            {"=", FilterExpression::Equal}, {"!=", FilterExpression::NotEqual},
+            {"<", FilterExpression::Less}, {"<=", FilterExpression::LessEqual},
+            {">", FilterExpression::Greater}, {">=", FilterExpression::GreaterEqual},
+            {"~", FilterExpression::Contains}
+        };
+
+        if (pos >= tokens.size() || tokens[pos].kind != Token::Word || !fields.contains(tokens[pos].text.toLower())) {
+            fail(pos < tokens.size() ? QString("Unknown field '%1'").arg(tokens[pos].text) : QString("Expected a field"));
+            return;
+        }
+
+        FilterExpression::Instruction instruction;
+        instruction.field = fields.value(tokens[pos++].text.toLower());
+
+        if (atKeyword("in")) {
+            pos++;
+            instruction.op = FilterExpression::In;
+            if (!atSymbol("(")) {
+                fail("Expected '(' after 'in'");
+                return;
+            }
+            pos++;
+            instruction.values << takeValue();
+            while (ok && atSymbol(",")) {
+                pos++;
+                instruction.values << takeValue();
+            }
+            if (ok && !atSymbol(")")) fail("Expected ')'");
+            pos++;
+        } else if (pos < tokens.size() && tokens[pos].kind == Token::Symbol && operators.contains(tokens[pos].text)) {
+            instruction.op = operators.value(tokens[pos++].text);
+            instruction.values << takeValue();
+        } else {
+            fail("Expected an operator");
+        }
+        if (!ok) return;
+
+        bool ordered = instruction.op == FilterExpression::Less || instruction.op == FilterExpression::LessEqual
+                       || instruction.op == FilterExpression::Greater || instruction.op == FilterExpression::GreaterEqual;
+
+        if (instruction.field == FilterExpression::Amount) {
+            if (instruction.op == FilterExpression::In || instruction.op == FilterExpression::Contains) {
+                fail("amount supports only comparisons");
+                return;
+            }
+            bool valid;
+            instruction.number = instruction.values.first().toDouble(&valid);
+            if (!valid) fail(QString("'%1' is not a number").arg(instruction.values.first()));
+        } else if (instruction.field == FilterExpression::Date) {
+            if (instruction.op == FilterExpression::In || instruction.op == FilterExpression::Contains) {
+                fail("date supports only comparisons");
+                return;
+            }
+            QDate date = QDate::fromString(instruction.values.first(), "yyyy-MM-dd");
+            if (!date.isValid()) fail(QString("'%1' is not a yyyy-MM-dd date").arg(instruction.values.first()));
+            instruction.day = date.toJulianDay();
+        } else if (ordered) {
+            fail("Text fields support =, !=, in and ~");
+        }
+
+        for (QString &value : instruction.values) {
+            value = FilterExpression::foldCase(value);
+        }
+        expression->program.append(instruction);
+    }
+
+    QString input;
+    FilterExpression *expression;
+    QVector<Token> tokens;
+    int pos = 0;
+    bool ok = true;
+    QString message;
+};
+
+// ================= CACHE =================
+
+namespace {
+
+const int MaxCachedFilters = 64;
+
+QHash<QString, QSharedPointer<const FilterExpression>> &filterCache() {
+    static QHash<QString, QSharedPointer<const FilterExpression>> cache;
+    return cache;
+}
+
+QStringList &filterCacheOrder() {
+    static QStringList order;  // least recently used first
+    return order;
+}
+
+// Collapses whitespace runs to one space so trivially different spellings share a cache entry.
+// Quoted literals are copied verbatim: "a  b" and "a b" are different filters.
+QString cacheKey(const QString &text) {
+    QString key;
+    key.reserve(text.size());
+    bool quoted = false;
+    bool pendingSpace = false;
+
+    for (int i = 0; i < text.size(); ++i) {
+        QChar c = text[i];
+        if (quoted) {
+            key += c;
+            if (c == '\\' && i + 1 < text.size()) {
+                key += text[++i];
+            } else if (c == '"') {
+                quoted = false;
+            }
+        } else if (c.isSpace()) {
+            pendingSpace = !key.isEmpty();
+        } else {
+            if (pendingSpace) key += ' ';
+            pendingSpace = false;
+            key += c;
+            quoted = c == '"';
+        }
+    }
+    return key;
+}
+
+}
+
+QSharedPointer<const FilterExpression> FilterExpression::compile(const QString &text, QString *error) {
+    QString key = cacheKey(text);
+    QHash<QString, QSharedPointer<const FilterExpression>> &cache = filterCache();
+    QStringList &order = filterCacheOrder();
+
+    auto cached = cache.constFind(key);
+    if (cached != cache.constEnd()) {
+        order.removeOne(key);
+        order.append(key);
+        return cached.value();
+    }
+
+    QSharedPointer<FilterExpression> expression(new FilterExpression());
+    expression->source = text;
+    FilterParser parser(text, expression.data());
+    if (!parser.parse(error)) {
+        return QSharedPointer<const FilterExpression>();
+    }
+    expression->buildSql();
+
+    if (cache.size() >= MaxCachedFilters && !order.isEmpty()) {
+        cache.remove(order.takeFirst());
+    }
+    cache.insert(key, expression);
+    order.append(key);
+    return expression;
+}
+
+void FilterExpression::clearCache() {
+    filterCache().clear();
+    filterCacheOrder().clear();
+}
+
+// Qt's SQLite driver offers no way to register a Unicode-aware function, so both forms use SQLite's ASCII folding
+QString FilterExpression::foldCase(const QString &text) {
+    QString folded = text.isNull() ? QString("") : text;
+    QChar *data = folded.data();
+    for (int i = 0; i < folded.size(); ++i) {
+        ushort c = data[i].unicode();
+        if (c >= 'A' && c <= 'Z') data[i] = QChar(c + ('a' - 'A'));
+    }
+    return folded;
+}
+
+int FilterExpression::cacheSize() {
+    return filterCache().size();
+}
+
+qint64 FilterExpression::cacheBytes() {
+    qint64 bytes = 0;
+    const QHash<QString, QSharedPointer<const FilterExpression>> &cache = filterCache();
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it) {
+        const FilterExpression &expression = *it.value();
+        bytes += sizeof(FilterExpression) + 2 * it.key().capacity() * sizeof(QChar) + expression.sqlFilter.where.capacity() * sizeof(QChar)
+                 + expression.program.capacity() * sizeof(Instruction) + expression.sqlFilter.bindings.size() * sizeof(QVariant);
+        for (const Instruction &instruction : expression.program) {
+            for (const QString &value : instruction.values) {
+                bytes += value.capacity() * sizeof(QChar);
+            }
+        }
+    }
+    return bytes;
+}
+
+// ================= SQL =================
+
+void FilterExpression::buildSql() {
+    // NULL text compares as '', as it does once loaded into LedgerColumns
+    static const char *columns[] = {"date", "amount", "COALESCE(category, '')", "COALESCE(description, '')",
+                                    "COALESCE(type, '')", "COALESCE(currency, '')"};
+    static const char *comparisons[] = {"=", "!=", "<", "<=", ">", ">="};
+
+    QStringList stack;
+    for (const Instruction &instruction : program) {
+        switch (instruction.op) {
+        case And:
+        case Or: {
+            QString right = stack.takeLast();
+            QString left = stack.takeLast();
+            stack.append(QString("(%1 %2 %3)").arg(left, instruction.op == And ? "AND" : "OR", right));
+            break;
+        }
+        case Not:
+            stack.append(QString("(NOT %1)").arg(stack.takeLast()));
+            break;
+        case In: {
+            QStringList placeholders;
+            for (const QString &value : instruction.values) {
+                placeholders << "?";
+                sqlFilter.bindings << value;
+            }
+            stack.append(QString("(lower(%1) IN (%2))").arg(columns[instruction.field], placeholders.join(", ")));
+            break;
+        }
+        case Contains: {
+            // instr() keeps '%' and '_' in the needle literal, unlike LIKE
+            stack.append(QString("(instr(lower(%1), ?) > 0)").arg(columns[instruction.field]));
+            sqlFilter.bindings << instruction.values.first();
+            break;
+        }
+        default: {
+            const char *comparison = comparisons[instruction.op];
+            if (instruction.field == Amount) {
+                stack.append(QString("(amount %1 ?)").arg(comparison));
+                sqlFilter.bindings << instruction.number;
+            } else if (instruction.field == Date) {
+                stack.append(QString("(date %1 ?)").arg(comparison));
+                sqlFilter.bindings << QDate::fromJulianDay(instruction.day).toString("yyyy-MM-dd");
+            } else {
+                stack.append(QString("(lower(%1) %2 ?)").arg(columns[instruction.field], comparison));
+                sqlFilter.bindings << instruction.values.first();
+            }
+            break;
+        }
+        }
+    }
+
+    sqlFilter.where = stack.isEmpty() ? QString() : stack.last();
+}
+
+// ================= PREDICATE PROGRAM =================
+
+namespace {
+
+// Marks which dictionary entries satisfy a text operator, so the row loop is a table lookup
+QVector<char> matchDictionary(const QStringList &names, FilterExpression::Op op, const QStringList &values) {
+    QVector<char> allowed(names.size(), 0);
+    for (int i = 0; i < names.size(); ++i) {
+        switch (op) {
+        case FilterExpression::Equal:
+        case FilterExpression::In:
+            allowed[i] = values.contains(names[i]);
+            break;
+        case FilterExpression::NotEqual:
+            allowed[i] = names[i] != values.first();
+            break;
+        case FilterExpression::Contains:
+            allowed[i] = names[i].contains(values.first());
+            break;
+        default:
+            break;
+        }
+    }
+    return allowed;
+}
+
+template <typename T, typename Compare>
+void compareColumn(const QVector<T> &column, T operand, char *mask, Compare compare) {
+    const T *data = column.constData();
+    const int count = column.size();
+    for (int i = 0; i < count; ++i) {
+        mask[i] = compare(data[i], operand);
+    }
+}
+
+template <typename T>
+void compareOrdered(const QVector<T> &column, T operand, FilterExpression::Op op, char *mask) {
+    switch (op) {
+    case FilterExpression::Equal: compareColumn(column, operand, mask, [](T a, T b) { return a == b; }); break;
+    case FilterExpression::NotEqual: compareColumn(column, operand, mask, [](T a, T b) { return a != b; }); break;
+    case FilterExpression::Less: compareColumn(column, operand, mask, [](T a, T b) { return a < b; }); break;
+    case FilterExpression::LessEqual: compareColumn(column, operand, mask, [](T a, T b) { return a <= b; }); break;
+    case FilterExpression::Greater: compareColumn(column, operand, mask, [](T a, T b) { return a > b; }); break;
+    case FilterExpression::GreaterEqual: compareColumn(column, operand, mask, [](T a, T b) { return a >= b; }); break;
+    default: break;
+    }
+}
+
+}
+
+QVector<char> FilterExpression::evaluate(const LedgerColumns &columns) const {
+    const int count = columns.size();
+    if (program.isEmpty()) return QVector<char>(count, 1);
+
+    QVector<QVector<char>> stack;
+    for (const Instruction &instruction : program) {
+        if (instruction.op == And || instruction.op == Or) {
+            QVector<char> right = stack.takeLast();
+            QVector<char> &left = stack.last();
+            char *out = left.data();
+            const char *in = right.constData();
+            if (instruction.op == And) {
+                for (int i = 0; i < count; ++i) out[i] &= in[i];
+            } else {
+                for (int i = 0; i < count; ++i) out[i] |= in[i];
+            }
+            continue;
+        }
+
+        if (instruction.op == Not) {
+            char *out = stack.last().data();
+            for (int i = 0; i < count; ++i) out[i] = !out[i];
+            continue;
+        }
+
+        QVector<char> mask(count, 0);
+        char *out = mask.data();
+
+        switch (instruction.field) {
+        case Amount:
+            compareOrdered(columns.amounts, instruction.number, instruction.op, out);
+            break;
+        case Date:
+            compareOrdered(columns.days, instruction.day, instruction.op, out);
+            break;
+        case Description: {
+            const QString *data = columns.descriptions.constData();
+            const QString &needle = instruction.values.first();
+            for (int i = 0; i < count; ++i) {
+                switch (instruction.op) {
+                case Equal: out[i] = data[i] == needle; break;
+                case NotEqual: out[i] = data[i] != needle; break;
+                case In: out[i] = instruction.values.contains(data[i]); break;
+                case Contains: out[i] = data[i].contains(needle); break;
+                default: break;
+                }
+            }
+            break;
+        }
+        default: {
+            const QVector<int> &column = instruction.field == Category ? columns.categories
+                                       : instruction.field == Type ? columns.types : columns.currencies;
+            const QStringList &names = instruction.field == Category ? columns.categoryNames
+                                     : instruction.field == Type ? columns.typeNames : columns.currencyNames;
+            QVector<char> allowed = matchDictionary(names, instruction.op, instruction.values);
+            const int *ids = column.constData();
+            const char *lookup = allowed.constData();
+            for (int i = 0; i < count; ++i) out[i] = lookup[ids[i]];
+            break;
+        }
+        }
+
+        stack.append(mask);
+    }
+
+    return stack.last();
+}
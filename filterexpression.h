@@ -0,0 +1,82 @@
+#ifndef FILTEREXPRESSION_H
+#define FILTEREXPRESSION_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "database.h"
+
+// Column-oriented copy of the loaded ledger for predicate evaluation.
+// Text columns are dictionary-encoded and case-folded so comparisons are integer tests.
+struct LedgerColumns {
+    QVector<int> ids;
+    QVector<qint64> days;
+    QVector<double> amounts;
+    QVector<int> categories;
+    QVector<int> types;
+    QVector<int> currencies;
+    QVector<QString> descriptions;
+    QStringList categoryNames;
+    QStringList typeNames;
+    QStringList currencyNames;
+
+    void clear();
+    void append(const TransactionRecord &record);
+    int size() const { return ids.size(); }
+    qint64 memoryUsage() const;
+    static LedgerColumns fromRecords(const QVector<TransactionRecord> &records);
+
+private:
+    QHash<QString, int> categoryIndex;
+    QHash<QString, int> typeIndex;
+    QHash<QString, int> currencyIndex;
+};
+
+// Filter language, e.g.
+//   amount > 100 and category in (Food, Transport) and not desc ~ "refund"
+// Fields: date, amount, category, desc/description, type, currency.
+// Operators: = != < <= > >= in (...) and ~ (case-insensitive contains), combined with and/or/not and parentheses.
+//
+// An expression compiles once into a postfix predicate program. It can be
+// rendered as a parameterized SQL WHERE clause or evaluated column-at-a-time
+// over LedgerColumns.
+class FilterExpression {
+public:
+    enum Field { Date, Amount, Category, Description, Type, Currency };
+    enum Op { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual, In, Contains, And, Or, Not };
+
+    struct Instruction {
+        Op op;
+        Field field = Date;
+        QStringList values;  // case-folded text operands
+        double number = 0.0; // amount operand
+        qint64 day = 0;      // date operand as julian day
+    };
+
+    // Returns a cached compiled form; null with *error set when the text does not parse
+    static QSharedPointer<const FilterExpression> compile(const QString &text, QString *error = nullptr);
+    static void clearCache();
+    static int cacheSize();
+    static qint64 cacheBytes();
+    // Folds only A-Z, exactly like SQLite's lower(), so the SQL and predicate forms agree on every row
+    static QString foldCase(const QString &text);
+
+    bool isEmpty() const { return program.isEmpty(); }
+    const SqlFilter &sql() const { return sqlFilter; }
+    // One byte per row: 1 when the row matches
+    QVector<char> evaluate(const LedgerColumns &columns) const;
+
+private:
+    FilterExpression() = default;
+    void buildSql();
+
+    QString source;
+    QVector<Instruction> program;
+    SqlFilter sqlFilter;
+
+    friend class FilterParser;
+};
+
+#endif
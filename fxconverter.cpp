@@ -0,0 +1,170 @@
+#include "fxconverter.h"
+#include <QDebug>
+#include <QtMath>
+#include <algorithm>
+
+const QString FxConverter::BaseCurrency = "EUR";
+
+void FxConverter::load() {
+    series.clear();
+    rateCache.clear();
+
+    // Rows arrive ordered by (currency, date), so each series is already sorted
+    QSqlQuery query = Database::getFxRates();
+    int count = 0;
+    while (query.next()) {
+        qint64 day = QDate::fromString(query.value(1).toString(), "yyyy-MM-dd").toJulianDay();
+        series[query.value(0).toString()].append(qMakePair(day, query.value(2).toDouble()));
+        count++;
+    }
+
+    loaded = true;
+    qDebug() << "Loaded" << count << "FX rates for" << series.size() << "currencies";
+}
+
+qint64 FxConverter::memoryUsage() const {
+    qint64 bytes = 0;
+    for (auto it = series.constBegin(); it != series.constEnd(); ++it) {
+        bytes += it.value().capacity() * sizeof(QPair<qint64, double>) + 64;
+    }
+    // Hash node: key, value, next pointer and hash
+    bytes += rateCache.size() * (sizeof(QPair<QString, qint64>) + sizeof(double) + 2 * sizeof(void *) + 8);
+    return bytes;
+}
+
+double FxConverter::lookup(const QString &currency, qint64 day) const {
+    if (currency == BaseCurrency) return 1.0;
+
+    auto it = series.constFind(currency);
+    if (it == series.constEnd() || it.value().isEmpty()) return 0.0;
+
+    const QVector<QPair<qint64, double>> &rates = it.value();
+    auto next = std::upper_bound(rates.constBegin(), rates.constEnd(), day,
+                                 [](qint64 value, const QPair<qint64, double> &entry) { return value < entry.first; });
+
+    // Before the first known rate, fall back to the earliest one rather than dropping the row
+    if (next == rates.constBegin()) return rates.first().second;
+    return (next - 1)->second;
+}
+
+double FxConverter::rate(const QString &currency, qint64 day) {
+    QPair<QString, qint64> key(currency, day);
+    auto cached = rateCache.constFind(key);
+    if (cached != rateCache.constEnd()) return cached.value();
+
+    double value = lookup(currency, day);
+    rateCache.insert(key, value);
+    return value;
+}
+
+int FxConverter::convert(const QVector<double> &amounts, const QVector<QString> &currencies, const QVector<qint64> &days,
+                         const QString &target, QVector<double> *converted, QStringList *missingCurrencies) {
+    int count = amounts.size();
+    converted->resize(count);
+
+    int missing = 0;
+    QString lastCurrency;
+    qint64 lastDay = -1;
+    double factor = 1.0;
+
+    for (int i = 0; i < count; ++i) {
+        // Rows come date-sorted, so runs of the same (currency, day) reuse the previous factor
+        if (days[i] != lastDay || currencies[i] != lastCurrency) {
+            lastDay = days[i];
+            lastCurrency = currencies[i];
+
+            if (lastCurrency == target) {
+                factor = 1.0;
+            } else {
+                double from = rate(lastCurrency, lastDay);
+                double to = rate(target, lastDay);
+                factor = (from > 0 && to > 0) ? from / to : 0.0;
+            }
+        }
+
+        if (factor > 0) {
+            (*converted)[i] = amounts[i] * factor;
+        } else {
+            (*converted)[i] = qQNaN();
+            missing++;
+            if (missingCurrencies && !missingCurrencies->contains(currencies[i])) missingCurrencies->append(currencies[i]);
+        }
+    }
+
+    return missing;
+}
+
+int FxConverter::convertRecords(QVector<TransactionRecord> &records, const QString &target, QStringList *missingCurrencies) {
+    if (!loaded) load();
+
+    int count = records.size();
+    QVector<double> amounts(count);
+    QVector<QString> currencies(count);
+    QVector<qint64> days(count);
+    for (int i = 0; i < count; ++i) {
+        amounts[i] = records[i].amount;
+        currencies[i] = records[i].currency;
+        days[i] = records[i].date.toJulianDay();
+    }
+
+    QVector<double> converted;
+    int missing = convert(amounts, currencies, days, target, &converted, missingCurrencies);
+
+    // Compact in place so the surviving rows keep their date order
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (qIsNaN(converted[i])) continue;
+        if (kept != i) records[kept] = records[i];
+        records[kept].amount = converted[i];
+        records[kept].currency = target;
+        kept++;
+    }
+    records.resize(kept);
+
+    if (missing > 0) {
+        qDebug() << missing << "transactions had no FX rate into" << target << "and were left out";
+    }
+    return missing;
+}
+
+int FxConverter::convertDailyTotals(QVector<DailyTotal> &totals, const QString &target, QStringList *missingCurrencies) {
+    if (!loaded) load();
+
+    int count = totals.size();
+    QVector<double> income(count);
+    QVector<double> expense(count);
+    QVector<QString> currencies(count);
+    QVector<qint64> days(count);
+    for (int i = 0; i < count; ++i) {
+        income[i] = totals[i].income;
+        expense[i] = totals[i].expense;
+        currencies[i] = totals[i].currency;
+        days[i] = totals[i].date.toJulianDay();
+    }
+
+    // The second pass hits the rate cache for every (currency, day) the first one looked up
+    QVector<double> convertedIncome;
+    QVector<double> convertedExpense;
+    int missing = convert(income, currencies, days, target, &convertedIncome, missingCurrencies);
+    convert(expense, currencies, days, target, &convertedExpense);
+
+    QVector<DailyTotal> merged;
+    merged.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (qIsNaN(convertedIncome[i])) continue;
+        if (merged.isEmpty() || merged.last().date != totals[i].date) {
+            DailyTotal total;
+            total.date = totals[i].date;
+            total.currency = target;
+            merged.append(total);
+        }
+        merged.last().income += convertedIncome[i];
+        merged.last().expense += convertedExpense[i];
+    }
+    totals.swap(merged);
+
+    if (missing > 0) {
+        qDebug() << missing << "daily totals had no FX rate into" << target << "and were left out";
+    }
+    return missing;
+}
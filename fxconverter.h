@@ -0,0 +1,45 @@
+#ifndef FXCONVERTER_H
+#define FXCONVERTER_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "database.h"
+
+// Converts amounts between currencies using the local fx_rates table.
+// Rates carry forward from the most recent earlier date; lookups are cached
+// per (currency, day) so batches only hit the rate series once per pair.
+class FxConverter {
+public:
+    static const QString BaseCurrency;
+
+    void load();
+    bool isLoaded() const { return loaded; }
+
+    // EUR value of one unit of currency on the given julian day; 0 when no rate is known
+    double rate(const QString &currency, qint64 day);
+
+    // Batched kernel over parallel arrays; rows without a rate come out as NaN and are counted in the result.
+    // Their currencies are added to missingCurrencies when given.
+    int convert(const QVector<double> &amounts, const QVector<QString> &currencies, const QVector<qint64> &days,
+                const QString &target, QVector<double> *converted, QStringList *missingCurrencies = nullptr);
+    // Both drop rows that cannot be converted rather than summing them in the wrong currency
+    int convertRecords(QVector<TransactionRecord> &records, const QString &target, QStringList *missingCurrencies = nullptr);
+    // Converts date-sorted per-currency totals and merges rows of the same date
+    int convertDailyTotals(QVector<DailyTotal> &totals, const QString &target, QStringList *missingCurrencies = nullptr);
+
+    qint64 cacheSize() const { return rateCache.size(); }
+    qint64 memoryUsage() const;
+    void clearCache() { rateCache.clear(); }
+
+private:
+    double lookup(const QString &currency, qint64 day) const;
+
+    bool loaded = false;
+    QHash<QString, QVector<QPair<qint64, double>>> series;  // currency -> (julian day, rate), sorted
+    QHash<QPair<QString, qint64>, double> rateCache;
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include "ledgerarchive.h"
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const char Magic[4] = {'F', 'T', 'A', 'R'};
+// Version 2 added the currency column; version 1 files read back as base currency
+const quint8 FormatVersion = 2;
+
+struct BlockInfo {
+    quint64 rowCount = 0;
+    qint64 minDay = 0;
+    qint64 maxDay = 0;
+    quint64 offset = 0;
+    quint64 size = 0;
+};
+
+void putVarint(QByteArray &out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+quint64 zigzag(qint64 value) {
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+qint64 unzigzag(quint64 value) {
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+void putString(QByteArray &out, const QString &value) {
+    QByteArray bytes = value.toUtf8();
+    putVarint(out, static_cast<quint64>(bytes.size()));
+    out.append(bytes);
+}
+
+// Bounds-checked cursor over an encoded buffer; any overrun sets ok to false
+struct Cursor {
+    const QByteArray &data;
+    int pos = 0;
+    bool ok = true;
+
+    explicit Cursor(const QByteArray &buffer) : data(buffer) {}
+
+    quint64 varint() {
+        quint64 value = 0;
+        int shift = 0;
+        while (ok) {
+            if (pos >= data.size() || shift > 63) {
+                ok = false;
+                break;
+            }
+            quint8 byte = static_cast<quint8>(data[pos++]);
+            value |= static_cast<quint64>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        return value;
+    }
+
+    QString string() {
+        quint64 length = varint();
+        if (!ok || length > static_cast<quint64>(data.size() - pos)) {
+            ok = false;
+            return QString();
+        }
+        QString value = QString::fromUtf8(data.constData() + pos, static_cast<int>(length));
+        pos += static_cast<int>(length);
+        return value;
+    }
+
+    QStringList dictionary() {
+        QStringList entries;
+        quint64 count = varint();
+        for (quint64 i = 0; ok && i < count; ++i) {
+            entries.append(string());
+        }
+        return entries;
+    }
+};
+
+int dictionaryIndex(QHash<QString, int> &index, QStringList &entries, const QString &value) {
+    auto it = index.constFind(value);
+    if (it != index.constEnd()) return it.value();
+    int id = entries.size();
+    index.insert(value, id);
+    entries.append(value);
+    return id;
+}
+
+}
+
+bool LedgerArchive::write(const QString &path, QVector<TransactionRecord> records) {
+    std::sort(records.begin(), records.end(), [](const TransactionRecord &a, const TransactionRecord &b) {
+        return a.date < b.date || (a.date == b.date && a.id < b.id);
+    });
+
+    QHash<QString, int> categoryIndex, typeIndex, currencyIndex;
+    QStringList categories, types, currencies;
+    QVector<BlockInfo> blocks;
+    QByteArray payload;
+
+    for (int begin = 0; begin < records.size(); begin += BlockRows) {
+        int end = qMin(records.size(), begin + BlockRows);
+
+        BlockInfo info;
+        info.rowCount = static_cast<quint64>(end - begin);
+        info.minDay = records[begin].date.toJulianDay();
+        info.maxDay = records[end - 1].date.toJulianDay();
+        info.offset = static_cast<quint64>(payload.size());
+
+        QByteArray block;
+
+        // Dates: non-negative deltas from the block minimum
+        qint64 previousDay = info.minDay;
+        for (int i = begin; i < end; ++i) {
+            qint64 day = records[i].date.toJulianDay();
+            putVarint(block, static_cast<quint64>(day - previousDay));
+            previousDay = day;
+        }
+
+        // Ids: zigzag deltas, since ids are only roughly increasing with date
+        qint64 previousId = 0;
+        for (int i = begin; i < end; ++i) {
+            putVarint(block, zigzag(records[i].id - previousId));
+            previousId = records[i].id;
+        }
+
+        for (int i = begin; i < end; ++i) {
+            putVarint(block, zigzag(qRound64(records[i].amount * 100)));
+        }
+
+        for (int i = begin; i < end; ++i) {
+            putVarint(block, static_cast<quint64>(dictionaryIndex(typeIndex, types, records[i].type)));
+        }
+
+        for (int i = begin; i < end; ++i) {
+            putVarint(block, static_cast<quint64>(dictionaryIndex(categoryIndex, categories, records[i].category)));
+        }
+
+        for (int i = begin; i < end; ++i) {
+            putVarint(block, static_cast<quint64>(dictionaryIndex(currencyIndex, currencies, records[i].currency)));
+        }
+
+        // Descriptions repeat heavily (merchants, subscriptions), so each block carries its own dictionary
+        QHash<QString, int> descriptionIndex;
+        QStringList descriptions;
+        QByteArray descriptionIds;
+        for (int i = begin; i < end; ++i) {
+            putVarint(descriptionIds, static_cast<quint64>(dictionaryIndex(descriptionIndex, descriptions, records[i].description)));
+        }
+        putVarint(block, static_cast<quint64>(descriptions.size()));
+        for (const QString &description : descriptions) {
+            putString(block, description);
+        }
+        block.append(descriptionIds);
+
+        info.size = static_cast<quint64>(block.size());
+        payload.append(block);
+        blocks.append(info);
+    }
+
+    QByteArray header;
+    putVarint(header, static_cast<quint64>(categories.size()));
+    for (const QString &category : categories) putString(header, category);
+    putVarint(header, static_cast<quint64>(types.size()));
+    for (const QString &type : types) putString(header, type);
+    putVarint(header, static_cast<quint64>(currencies.size()));
+    for (const QString &currency : currencies) putString(header, currency);
+
+    putVarint(header, static_cast<quint64>(blocks.size()));
+    for (const BlockInfo &info : blocks) {
+        putVarint(header, info.rowCount);
+        putVarint(header, zigzag(info.minDay));
+        putVarint(header, static_cast<quint64>(info.maxDay - info.minDay));
+        putVarint(header, info.offset);
+        putVarint(header, info.size);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open archive for writing:" << path;
+        return false;
+    }
+
+    QByteArray prefix(Magic, 4);
+    prefix.append(static_cast<char>(FormatVersion));
+    quint32 headerSize = static_cast<quint32>(header.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        prefix.append(static_cast<char>((headerSize >> shift) & 0xFF));
+    }
+
+    if (file.write(prefix) != prefix.size() || file.write(header) != header.size() || file.write(payload) != payload.size()) {
+        qDebug() << "Failed to write archive:" << file.errorString();
+        return false;
+    }
+
+    qDebug() << "Wrote" << records.size() << "transactions in" << blocks.size() << "blocks ("
+             << (prefix.size() + header.size() + payload.size()) << "bytes) to" << path;
+    return true;
+}
+
+QVector<TransactionRecord> LedgerArchive::read(const QString &path, const QDate &from, const QDate &to, ArchiveScanStats *stats) {
+    QVector<TransactionRecord> records;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open archive:" << path;
+        return records;
+    }
+
+    QByteArray prefix = file.read(9);
+    quint8 version = prefix.size() == 9 ? static_cast<quint8>(prefix[4]) : 0;
+    if (prefix.size() != 9 || !prefix.startsWith(QByteArray(Magic, 4)) || version < 1 || version > FormatVersion) {
+        qDebug() << "Not a supported archive:" << path;
+        return records;
+    }
+
+    quint32 headerSize = 0;
+    for (int i = 0; i < 4; ++i) {
+        headerSize |= static_cast<quint32>(static_cast<quint8>(prefix[5 + i])) << (8 * i);
+    }
+
+    QByteArray header = file.read(headerSize);
+    Cursor cursor(header);
+    QStringList categories = cursor.dictionary();
+    QStringList types = cursor.dictionary();
+    QStringList currencies = version >= 2 ? cursor.dictionary() : QStringList{"EUR"};
+
+    QVector<BlockInfo> blocks;
+    quint64 blockCount = cursor.varint();
+    for (quint64 i = 0; cursor.ok && i < blockCount; ++i) {
+        BlockInfo info;
+        info.rowCount = cursor.varint();
+        info.minDay = unzigzag(cursor.varint());
+        info.maxDay = info.minDay + static_cast<qint64>(cursor.varint());
+        info.offset = cursor.varint();
+        info.size = cursor.varint();
+        blocks.append(info);
+    }
+
+    if (!cursor.ok || header.size() != static_cast<int>(headerSize)) {
+        qDebug() << "Corrupt archive header:" << path;
+        return records;
+    }
+
+    qint64 fromDay = from.isValid() ? from.toJulianDay() : std::numeric_limits<qint64>::min();
+    qint64 toDay = to.isValid() ? to.toJulianDay() : std::numeric_limits<qint64>::max();
+    qint64 payloadStart = 9 + static_cast<qint64>(headerSize);
+
+    ArchiveScanStats scan;
+    scan.blocksTotal = blocks.size();
+
+    for (const BlockInfo &info : blocks) {
+        if (info.rowCount > static_cast<quint64>(BlockRows)) {
+            qDebug() << "Corrupt archive block directory:" << path;
+            break;
+        }
+
+        // Block skipping: the directory's min/max dates decide without touching the payload
+        if (info.maxDay < fromDay || info.minDay > toDay) continue;
+
+        if (!file.seek(payloadStart + static_cast<qint64>(info.offset))) break;
+        QByteArray block = file.read(static_cast<qint64>(info.size));
+        Cursor column(block);
+        int rows = static_cast<int>(info.rowCount);
+        scan.blocksRead++;
+
+        QVector<qint64> days(rows), ids(rows), cents(rows);
+        QVector<int> typeIds(rows), categoryIds(rows), currencyIds(rows, 0);
+
+        qint64 day = info.minDay;
+        for (int i = 0; i < rows; ++i) days[i] = (day += static_cast<qint64>(column.varint()));
+        qint64 id = 0;
+        for (int i = 0; i < rows; ++i) ids[i] = (id += unzigzag(column.varint()));
+        for (int i = 0; i < rows; ++i) cents[i] = unzigzag(column.varint());
+        for (int i = 0; i < rows; ++i) typeIds[i] = static_cast<int>(column.varint());
+        for (int i = 0; i < rows; ++i) categoryIds[i] = static_cast<int>(column.varint());
+        if (version >= 2) {
+            for (int i = 0; i < rows; ++i) currencyIds[i] = static_cast<int>(column.varint());
+        }
+        QStringList descriptions = column.dictionary();
+
+        for (int i = 0; column.ok && i < rows; ++i) {
+            int descriptionId = static_cast<int>(column.varint());
+            if (days[i] < fromDay || days[i] > toDay) continue;
+
+            if (typeIds[i] < 0 || categoryIds[i] < 0 || currencyIds[i] < 0 || descriptionId < 0
+                || currencyIds[i] >= currencies.size()
+                || typeIds[i] >= types.size() || categoryIds[i] >= categories.size() || descriptionId >= descriptions.size()) {
+                column.ok = false;
+                break;
+            }
+
+            TransactionRecord record;
+            record.id = static_cast<int>(ids[i]);
+            record.date = QDate::fromJulianDay(days[i]);
+            record.category = categories[categoryIds[i]];
+            record.description = descriptions[descriptionId];
+            record.amount = cents[i] / 100.0;
+            record.type = types[typeIds[i]];
+            record.currency = currencies[currencyIds[i]];
+            records.append(record);
+        }
+
+        if (!column.ok) {
+            qDebug() << "Corrupt archive block at offset" << info.offset << "in" << path;
+            break;
+        }
+    }
+
+    scan.rowsReturned = records.size();
+    if (stats) *stats = scan;
+    return records;
+}
@@ -0,0 +1,31 @@
+#ifndef LEDGERARCHIVE_H
+#define LEDGERARCHIVE_H
+
+#include <QString>
+#include <QVector>
+#include "database.h"
+
+struct ArchiveScanStats {
+    int blocksTotal = 0;
+    int blocksRead = 0;
+    int rowsReturned = 0;
+};
+
+// Compact columnar file format for closed periods (*.ftarc).
+//
+// Layout: magic "FTAR", version byte, u32 header size, then the header:
+// category, type and currency dictionaries and a block directory (row count,
+// min/max julian day, offset, size per block). Block payloads follow. Inside a
+// block, columns are stored one after another: dates as day deltas, ids as
+// zigzag deltas, cents as zigzag varints, types/categories/currencies as
+// dictionary indexes and descriptions through a block-local dictionary.
+class LedgerArchive {
+public:
+    static bool write(const QString &path, QVector<TransactionRecord> records);
+    // Reads rows in [from, to]; blocks whose date range misses the window are never decoded
+    static QVector<TransactionRecord> read(const QString &path, const QDate &from, const QDate &to, ArchiveScanStats *stats = nullptr);
+
+    static const int BlockRows = 4096;
+};
+
+#endif
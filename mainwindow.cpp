@@ -12,20 +12,104 @@
 #include <QFile>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QInputDialog>
+#include <QTimer>
+#include <QSet>
+#include <QHash>
+#include <algorithm>
+#include <climits>
+#include <functional>
 #include "customtablewidget.h"
+#include "reportspanel.h"
+#include "duplicatefinder.h"
+#include "ledgerarchive.h"
+#include "budgetengine.h"
+#include <QStatusBar>
+#include <QSplitter>
+#include "spendingchart.h"
+#include "memoryaccountant.h"
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+
+// Rough per-row cost of the table: seven QTableWidgetItems with their role data, plus the text
+static qint64 estimatedRowBytes(const TransactionRecord &record) {
+    const qint64 cellOverhead = 160;
+    qint64 characters = record.category.size() + record.description.size() + record.type.size() + record.currency.size() + 30;
+    return 7 * cellOverhead + characters * static_cast<qint64>(sizeof(QChar));
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent) {
     setupUI();
 
+    // Alerts are queued so the writer that crossed a threshold never waits on the UI
+    budgetEngine = new BudgetEngine(this);
+    connect(budgetEngine, &BudgetEngine::budgetAlert, this, &MainWindow::onBudgetAlert, Qt::QueuedConnection);
+    connect(budgetEngine, &BudgetEngine::ratesMissing, this, [=](const QString &currency) {
+        statusBar()->showMessage(QString("No FX rate from %1 to %2: %1 spending is left out of budget checks until rates are imported")
+                                     .arg(currency, FxConverter::BaseCurrency), 10000);
+    }, Qt::QueuedConnection);
+
+    // The table and budget totals are the working set; column copies and compiled filters can be rebuilt on demand
+    MemoryAccountant::registerConsumer("Table rows", [this]() { return transactionTable->rowCount() * averageRowBytes; });
+    MemoryAccountant::registerConsumer("Budget totals", [this]() { return budgetEngine->memoryUsage(); });
+    MemoryAccountant::registerConsumer("Filter columns", [this]() { return ledgerColumns.memoryUsage(); }, [this]() {
+        ledgerColumns = LedgerColumns();
+        ledgerColumnsDirty = true;
+    });
+    MemoryAccountant::registerConsumer("Filter cache", []() { return FilterExpression::cacheBytes(); },
+                                       []() { FilterExpression::clearCache(); });
+    MemoryAccountant::registerConsumer("Chart FX rates", [this]() { return chartFx.memoryUsage(); }, [this]() { chartFx.clearCache(); });
+
+    journal = new EditJournal(this);
+    connect(journal, &EditJournal::undoStateChanged, this, [=](bool canUndo, bool canRedo) {
+        undoButton->setEnabled(canUndo);
+        redoButton->setEnabled(canRedo);
+    });
+    // The chart is built from SQLite aggregates, so it catches up once a group commit lands
+    connect(journal, &EditJournal::flushed, this, &MainWindow::refreshChart);
+    MemoryAccountant::registerConsumer("Edit journal", [this]() { return journal->memoryUsage(); });
+    MemoryAccountant::registerConsumer("Recurring windows", [this]() { return recurrence.memoryUsage(); },
+                                       [this]() { recurrence.clearCache(); });
+    reportsPanel->setRecurrenceEngine(&recurrence);
+
     if (!Database::initialize()) {
         QMessageBox::critical(this, "Database Error", "Failed to connect to the database.");
     } else {
+        // Replays edits that were acknowledged but not yet committed when the app last stopped
+        if (!journal->open()) {
+            QMessageBox::warning(this, "Journal Error", "Could not open the edit journal; changes cannot be saved.");
+        }
+
+        // Rules load first so the table can show their scheduled rows in the viewed window
+        recurrence.load();
         loadTransactions();  
+
+        budgetEngine->load();
+        materializeRecurring();
+
+        QTimer *changePollTimer = new QTimer(this);
+        connect(changePollTimer, &QTimer::timeout, this, &MainWindow::pollChanges);
+        changePollTimer->start(1000);
+
+        // Keep the change log bounded; stale readers fall back to a full reload
+        Database::compactChanges();
+        QTimer *compactTimer = new QTimer(this);
+        connect(compactTimer, &QTimer::timeout, this, []() { Database::compactChanges(); });
+        connect(compactTimer, &QTimer::timeout, this, &MainWindow::materializeRecurring);
+        compactTimer->start(60 * 60 * 1000);
     }
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow() {
+    journal->flush();
+    for (const QString &name : {"Table rows", "Budget totals", "Filter columns", "Filter cache", "Chart FX rates", "Edit journal", "Recurring windows"}) {
+        MemoryAccountant::unregisterConsumer(name);
+    }
+}
 
 void MainWindow::setupUI() {
     QWidget *centralWidget = new QWidget(this);
@@ -59,6 +143,10 @@ void MainWindow::setupUI() {
     amountInput->setPlaceholderText("0.00");
     formLayout->addWidget(amountInput);
 
+    formLayout->addWidget(new QLabel("Currency:"));
+    currencyInput = createComboBox({"EUR", "USD", "SEK"});
+    formLayout->addWidget(currencyInput);
+
     // Form Buttons
     addButton = createStyledButton("Add", "#4CAF50", "#45A049");
     connect(addButton, &QPushButton::clicked, this, &MainWindow::addTransaction);
@@ -72,6 +160,16 @@ void MainWindow::setupUI() {
     connect(deleteButton, &QPushButton::clicked, this, &MainWindow::deleteTransaction);
     formLayout->addWidget(deleteButton);
 
+    undoButton = createStyledButton("Undo", "#607D8B", "#455A64", true);
+    undoButton->setShortcut(QKeySequence::Undo);
+    connect(undoButton, &QPushButton::clicked, this, &MainWindow::undoEdit);
+    formLayout->addWidget(undoButton);
+
+    redoButton = createStyledButton("Redo", "#607D8B", "#455A64", true);
+    redoButton->setShortcut(QKeySequence::Redo);
+    connect(redoButton, &QPushButton::clicked, this, &MainWindow::redoEdit);
+    formLayout->addWidget(redoButton);
+
     mainLayout->addLayout(formLayout);
     mainLayout->setSpacing(20);
 
@@ -89,6 +187,45 @@ void MainWindow::setupUI() {
     connect(exportButton, &QPushButton::clicked, this, &MainWindow::exportToCSV);
     topButtonLayout->addWidget(exportButton);
 
+    QPushButton *duplicatesButton = createStyledButton("Find Duplicates", "#795548", "#5D4037");
+    duplicatesButton->setFixedWidth(120);
+    connect(duplicatesButton, &QPushButton::clicked, this, &MainWindow::findDuplicates);
+    topButtonLayout->addWidget(duplicatesButton);
+
+    QPushButton *archiveButton = createStyledButton("Archive Year", "#009688", "#00796B");
+    archiveButton->setFixedWidth(120);
+    connect(archiveButton, &QPushButton::clicked, this, &MainWindow::archiveYear);
+    topButtonLayout->addWidget(archiveButton);
+
+    QPushButton *exportArchiveButton = createStyledButton("Export Archive", "#009688", "#00796B");
+    exportArchiveButton->setFixedWidth(120);
+    connect(exportArchiveButton, &QPushButton::clicked, this, &MainWindow::exportArchive);
+    topButtonLayout->addWidget(exportArchiveButton);
+
+    QPushButton *budgetsButton = createStyledButton("Budgets", "#8BC34A", "#689F38");
+    budgetsButton->setFixedWidth(120);
+    connect(budgetsButton, &QPushButton::clicked, this, &MainWindow::editBudgets);
+    topButtonLayout->addWidget(budgetsButton);
+
+    QPushButton *recurringButton = createStyledButton("Recurring", "#8BC34A", "#689F38");
+    recurringButton->setFixedWidth(120);
+    connect(recurringButton, &QPushButton::clicked, this, &MainWindow::editRecurring);
+    topButtonLayout->addWidget(recurringButton);
+
+    QPushButton *importRatesButton = createStyledButton("Import Rates", "#00BCD4", "#0097A7");
+    importRatesButton->setFixedWidth(120);
+    connect(importRatesButton, &QPushButton::clicked, this, &MainWindow::importFxRates);
+    topButtonLayout->addWidget(importRatesButton);
+
+    QPushButton *showReportsButton = createStyledButton("Show Reports", "#3F51B5", "#303F9F");
+    showReportsButton->setFixedWidth(120);
+    topButtonLayout->addWidget(showReportsButton);
+
+    QPushButton *diagnosticsButton = createStyledButton("Diagnostics", "#9C27B0", "#7B1FA2");
+    diagnosticsButton->setFixedWidth(120);
+    connect(diagnosticsButton, &QPushButton::clicked, this, &MainWindow::showDiagnostics);
+    topButtonLayout->addWidget(diagnosticsButton);
+
     QPushButton *toggleDarkModeButton = createStyledButton("Dark Mode", "#9E9E9E", "#757575");
     toggleDarkModeButton->setFixedWidth(120);
     connect(toggleDarkModeButton, &QPushButton::clicked, this, [=]() {
@@ -133,6 +270,11 @@ void MainWindow::setupUI() {
     filterEndDate = createDateEdit(QDate::currentDate());
     filterLayout->addWidget(filterEndDate);
 
+    filterExpression = new QLineEdit(this);
+    filterExpression->setPlaceholderText("e.g. amount > 100 and category in (Food, Transport) and not desc ~ \"refund\"");
+    filterExpression->setMinimumWidth(250);
+    filterLayout->addWidget(filterExpression);
+
     QPushButton *applyFiltersButton = createStyledButton("Apply Filters", "#2196F3", "#1976D2");
     connect(applyFiltersButton, &QPushButton::clicked, this, &MainWindow::applyFilters);
     filterLayout->addWidget(applyFiltersButton);
@@ -148,12 +290,27 @@ void MainWindow::setupUI() {
     });
 
     connect(searchInput, &QLineEdit::textChanged, this, &MainWindow::applyFilters);
+    connect(filterExpression, &QLineEdit::returnPressed, this, &MainWindow::applyFilters);
+
+    // ================= REPORTS SECTION =================
+    reportsPanel = new ReportsPanel(this);
+    reportsPanel->setVisible(false);
+    mainLayout->addWidget(reportsPanel);
+
+    connect(showReportsButton, &QPushButton::clicked, this, [=]() {
+        bool isVisible = reportsPanel->isVisible();
+        reportsPanel->setVisible(!isVisible);
+        showReportsButton->setText(isVisible ? "Show Reports" : "Hide Reports");
+        if (!isVisible && flushJournal()) {
+            reportsPanel->runReport();
+        }
+    });
 
     // ================= TRANSACTION TABLE =================
     transactionTable = new CustomTableWidget(this);
     transactionTable->setStyleSheet("QTableWidget::item:selected { background-color:rgb(115, 139, 160); }");
-    transactionTable->setColumnCount(6);
-    transactionTable->setHorizontalHeaderLabels({"ID", "Date (Y-m-d)", "Category", "Description", "Amount", "Type"});
+    transactionTable->setColumnCount(7);
+    transactionTable->setHorizontalHeaderLabels({"ID", "Date (Y-m-d)", "Category", "Description", "Amount", "Type", "Currency"});
     transactionTable->setColumnHidden(0, true);
     transactionTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     transactionTable->resizeRowsToContents();
@@ -195,7 +352,34 @@ void MainWindow::setupUI() {
     connect(transactionTable->horizontalHeader(), &QHeaderView::sectionDoubleClicked, this, &MainWindow::clearSorting);
     connect(transactionTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::onTransactionSelected);
     connect(transactionTable, &CustomTableWidget::rowDeselected, this, &MainWindow::clearForm);
-    mainLayout->addWidget(transactionTable);
+
+    // ================= SPENDING CHART =================
+    spendingChart = new SpendingChart(this);
+
+    QSplitter *tableSplitter = new QSplitter(Qt::Horizontal, this);
+    tableSplitter->addWidget(transactionTable);
+    tableSplitter->addWidget(spendingChart);
+    tableSplitter->setStretchFactor(0, 3);
+    tableSplitter->setStretchFactor(1, 2);
+    mainLayout->addWidget(tableSplitter);
+
+    // Only shown in paged mode, when the table cannot hold every row
+    pageControls = new QWidget(this);
+    QHBoxLayout *pageLayout = new QHBoxLayout(pageControls);
+    pageLayout->setContentsMargins(0, 0, 0, 0);
+    newerPageButton = createStyledButton("Newer", "#607D8B", "#455A64");
+    newerPageButton->setFixedWidth(120);
+    connect(newerPageButton, &QPushButton::clicked, this, &MainWindow::showNewerPage);
+    pageLayout->addWidget(newerPageButton);
+    pageLabel = new QLabel(pageControls);
+    pageLabel->setAlignment(Qt::AlignCenter);
+    pageLayout->addWidget(pageLabel, 1);
+    olderPageButton = createStyledButton("Older", "#607D8B", "#455A64");
+    olderPageButton->setFixedWidth(120);
+    connect(olderPageButton, &QPushButton::clicked, this, &MainWindow::showOlderPage);
+    pageLayout->addWidget(olderPageButton);
+    pageControls->setVisible(false);
+    mainLayout->addWidget(pageControls);
 
     // Ctrl + D for Date Sorting
     sortByDateShortcut = new QShortcut(QKeySequence("Ctrl+D"), this);
@@ -261,6 +445,7 @@ void MainWindow::clearForm() {
     dateInput->setDate(QDate::currentDate());
     categoryInput->setCurrentIndex(0);
     typeInput->setCurrentIndex(0);
+    currencyInput->setCurrentIndex(0);
     selectedTransactionId = -1;
     editButton->setEnabled(false);
     deleteButton->setEnabled(false);
@@ -269,6 +454,7 @@ void MainWindow::clearForm() {
 void MainWindow::clearFilters() {
     // Reset all filter inputs to their default values
     searchInput->clear();
+    filterExpression->clear();
     filterCategory->setCurrentIndex(0);  // "All Categories"
     filterType->setCurrentIndex(0);      // "All Types"
     filterStartDate->setDate(QDate::currentDate().addMonths(-1));  // Last month
@@ -296,6 +482,7 @@ void MainWindow::addTransaction() {
     QString description = descriptionInput->text();
     QString amountText = amountInput->text();
     QString type = typeInput->currentText();
+    QString currency = currencyInput->currentText();
 
     if (description.isEmpty() || amountText.isEmpty()) {
         QMessageBox::warning(this, "Input Error", "Please fill in all fields.");
@@ -309,10 +496,26 @@ void MainWindow::addTransaction() {
         return;
     }
 
-    if (Database::addTransaction(date, category, description, amount, type)) {
-        transactionTable->setSortingEnabled(false);
-        loadTransactions();
-        transactionTable->setSortingEnabled(true); 
+    // Recent adds may still be in the journal, so the check covers pending edits as well as SQLite
+    if (journal->findDuplicate(date, amount, type, description, currency) != -1) {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Possible Duplicate",
+            "A transaction with the same date, amount, type and description already exists. Add it anyway?",
+            QMessageBox::Yes | QMessageBox::No);
+        if (reply != QMessageBox::Yes) return;
+    }
+
+    JournalEntry entry;
+    entry.kind = JournalEntry::Add;
+    entry.after.id = journal->allocateId();
+    entry.after.date = dateInput->date();
+    entry.after.category = category;
+    entry.after.description = description;
+    entry.after.amount = amount;
+    entry.after.type = type;
+    entry.after.currency = currency;
+
+    if (entry.after.id != -1 && journal->record(entry)) {
+        applyEntry(entry);
         clearForm(); 
     } else {
         QMessageBox::critical(this, "Database Error", "Failed to add transaction.");
@@ -320,38 +523,305 @@ void MainWindow::addTransaction() {
 }
 
 void MainWindow::loadTransactions() {
+    // Re-reading SQLite before the journal reached it would drop pending edits from the table
+    if (!flushJournal()) return;
     transactionTable->setRowCount(0);  
 
-    QSqlQuery query = Database::getAllTransactions();
-    int row = 0;
+    // Whatever the budget leaves after the other fixed structures decides how many rows fit in the table
+    if (averageRowBytes == 0) {
+        TransactionRecord typical;
+        typical.category = "Entertainment";
+        typical.description = QString(24, QChar('x'));
+        typical.type = "Expense";
+        averageRowBytes = estimatedRowBytes(typical);
+    }
+    qint64 available = MemoryAccountant::budget() - MemoryAccountant::unevictableUsage();
+    rowLimit = static_cast<int>(qBound<qint64>(1000, available / averageRowBytes, INT_MAX));
+    int total = Database::transactionCount();
+    pagedMode = total > rowLimit;
+
+    QVector<TransactionRecord> records;
+    if (pagedMode) {
+        pageOffset = 0;
+        pageFilter.reset();
+        pageFilterText.clear();
+        records = loadPage();
+    } else {
+        records = Database::queryTransactions(nullptr);
+        populateTable(records);
+    }
+    pageControls->setVisible(pagedMode);
+    showScheduledRows();
 
-    while (query.next()) {
-        qDebug() << "Loading row:" << row << query.value(0).toString();
-        transactionTable->insertRow(row);
-        transactionTable->setItem(row, 0, new QTableWidgetItem(query.value(0).toString()));  // ID (hidden)
-        transactionTable->setItem(row, 1, new QTableWidgetItem(query.value(1).toString()));  // Date
-        transactionTable->setItem(row, 2, new QTableWidgetItem(query.value(2).toString()));  // Categoryd
-        transactionTable->setItem(row, 3, new QTableWidgetItem(query.value(3).toString()));  // Description (fixed)
-        transactionTable->setItem(row, 4, new QTableWidgetItem(QString::number(query.value(4).toDouble(), 'f', 2)));  // Amount
-        QString type = query.value(5).toString();  // Type (income/expense)
-        QTableWidgetItem *typeItem = new QTableWidgetItem(type);
-
-        if (type == "Income") {
-            typeItem->setForeground(QColor("green"));
+    qint64 loadedBytes = 0;
+    for (const TransactionRecord &record : records) {
+        loadedBytes += estimatedRowBytes(record);
+    }
+    int row = records.size();
+    if (pagedMode) {
+        statusBar()->showMessage(QString("Showing the newest %1 of %2 transactions to stay within the memory budget; "
+                                         "filters query the database and Older/Newer page through the rest").arg(row).arg(total));
+    }
+    qDebug() << "Total rows loaded:" << row << (pagedMode ? "(paged)" : "");
+    if (row > 0) averageRowBytes = loadedBytes / row;
+
+    // Everything up to here is reflected in the table; later polls only need newer change-log entries
+    lastChangeSeq = Database::latestChangeSeq();
+    lastDataVersion = Database::dataVersion();
+
+    refreshChart();
+    ledgerColumns = LedgerColumns();
+    ledgerColumnsDirty = true;
+
+    MemoryAccountant::enforce();
+    MemoryAccountant::logUsage();
+}
+
+void MainWindow::populateTable(const QVector<TransactionRecord> &records) {
+    transactionTable->setRowCount(records.size());
+    for (int row = 0; row < records.size(); ++row) {
+        setTransactionRow(row, records[row]);
+    }
+}
+
+// Replaces the table with the page at pageOffset; one extra row is read to learn whether older ones exist
+QVector<TransactionRecord> MainWindow::loadPage() {
+    QVector<TransactionRecord> records = Database::queryTransactions(pageFilter ? &pageFilter->sql() : nullptr, rowLimit + 1, pageOffset);
+    bool hasOlder = records.size() > rowLimit;
+    if (hasOlder) records.removeLast();
+
+    bool sorting = transactionTable->isSortingEnabled();
+    transactionTable->setSortingEnabled(false);
+    populateTable(records);
+    transactionTable->setSortingEnabled(sorting);
+
+    newerPageButton->setEnabled(pageOffset > 0);
+    olderPageButton->setEnabled(hasOlder);
+    pageLabel->setText(records.isEmpty() ? QString("No matching transactions")
+                                         : QString("Transactions %1-%2, newest first").arg(pageOffset + 1).arg(pageOffset + records.size()));
+    ledgerColumnsDirty = true;
+    return records;
+}
+
+void MainWindow::showNewerPage() {
+    if (!pagedMode || pageOffset == 0 || !flushJournal()) return;
+    pageOffset = qMax(0, pageOffset - rowLimit);
+    loadPage();
+    showScheduledRows();
+    updateTableColors();
+}
+
+void MainWindow::showOlderPage() {
+    if (!pagedMode || !flushJournal()) return;
+    pageOffset += rowLimit;
+    loadPage();
+    showScheduledRows();
+    updateTableColors();
+}
+
+// The chart sums every currency, so per-currency daily totals are converted to the base currency first
+void MainWindow::refreshChart() {
+    if (!archivedTotalsLoaded) {
+        archivedTotals = Database::archivedTotals();
+        archivedTotalsLoaded = true;
+    }
+
+    // Archived years only feed the balance the hot rows start from
+    QVector<DailyTotal> archived = archivedTotals;
+    QVector<DailyTotal> totals = Database::dailyTotals();
+    QStringList missingCurrencies;
+    int skipped = chartFx.convertDailyTotals(archived, FxConverter::BaseCurrency, &missingCurrencies);
+    skipped += chartFx.convertDailyTotals(totals, FxConverter::BaseCurrency, &missingCurrencies);
+    if (skipped > 0) {
+        missingCurrencies.removeDuplicates();
+        statusBar()->showMessage(QString("The chart leaves out %1 amounts: no FX rate to %2")
+                                     .arg(missingCurrencies.join(", "), FxConverter::BaseCurrency), 10000);
+    }
+
+    double openingBalance = 0.0;
+    for (const DailyTotal &total : archived) {
+        openingBalance += total.income - total.expense;
+    }
+    spendingChart->setDailyTotals(totals, openingBalance);
+}
+
+// Mirrors one journaled edit into the table and the budget totals without waiting for SQLite
+void MainWindow::applyEntry(const JournalEntry &entry) {
+    bool sorting = transactionTable->isSortingEnabled();
+    transactionTable->setSortingEnabled(false);
+
+    int row = rowForId(entry.id());
+    switch (entry.kind) {
+    case JournalEntry::Add:
+        if (row == -1) {
+            row = 0;
+            transactionTable->insertRow(row);
+        }
+        setTransactionRow(row, entry.after);
+        transactionTable->setRowHidden(row, !matchesFilter(entry.after));
+        budgetEngine->recordAdded(entry.after);
+        break;
+    case JournalEntry::Update:
+        if (row != -1) setTransactionRow(row, entry.after);
+        budgetEngine->recordUpdated(entry.before, entry.after);
+        break;
+    case JournalEntry::Remove:
+        if (row != -1) transactionTable->removeRow(row);
+        if (entry.id() == selectedTransactionId) clearForm();
+        budgetEngine->recordRemoved(entry.before);
+        break;
+    }
+
+    transactionTable->setSortingEnabled(sorting);
+    updateTableColors();
+    ledgerColumnsDirty = true;
+}
+
+// Pending edits are safe in the journal file either way; on failure the caller must not re-read SQLite yet
+bool MainWindow::flushJournal() {
+    if (journal->flush()) return true;
+    statusBar()->showMessage("Could not save recent edits to the database (it may be busy); they are kept and retried", 10000);
+    return false;
+}
+
+int MainWindow::rowForId(int id) const {
+    for (int row = 0; row < transactionTable->rowCount(); ++row) {
+        QTableWidgetItem *idItem = transactionTable->item(row, 0);
+        if (idItem && idItem->text().toInt() == id) return row;
+    }
+    return -1;
+}
+
+void MainWindow::undoEdit() {
+    JournalEntry entry;
+    if (journal->undo(&entry)) {
+        applyEntry(entry);
+        statusBar()->showMessage("Undone", 3000);
+    }
+}
+
+void MainWindow::redoEdit() {
+    JournalEntry entry;
+    if (journal->redo(&entry)) {
+        applyEntry(entry);
+        statusBar()->showMessage("Redone", 3000);
+    }
+}
+
+void MainWindow::setTransactionRow(int row, const TransactionRecord &record) {
+    transactionTable->setItem(row, 0, new QTableWidgetItem(QString::number(record.id)));  // ID (hidden)
+    transactionTable->setItem(row, 1, new QTableWidgetItem(record.date.toString("yyyy-MM-dd")));  // Date
+    transactionTable->setItem(row, 2, new QTableWidgetItem(record.category));  // Category
+    transactionTable->setItem(row, 3, new QTableWidgetItem(record.description));  // Description
+    transactionTable->setItem(row, 4, new QTableWidgetItem(QString::number(record.amount, 'f', 2)));  // Amount
+    QTableWidgetItem *typeItem = new QTableWidgetItem(record.type);  // Type (income/expense)
+
+    if (record.type == "Income") {
+        typeItem->setForeground(QColor("green"));
+    } else {
+        typeItem->setForeground(QColor("red"));
+    }
+
+    transactionTable->setItem(row, 5, typeItem); 
+    transactionTable->setItem(row, 6, new QTableWidgetItem(record.currency));  // Currency
+}
+
+// Applies rows changed by other processes without reloading the whole table
+void MainWindow::pollChanges() {
+    // data_version only moves for commits from other connections, so an idle tick costs one pragma
+    // and leaves our pending edits to the journal's own timer and size threshold
+    qint64 version = Database::dataVersion();
+    if (version == lastDataVersion) return;
+
+    // Our own pending edits go first so refreshed rows and budget totals already include them;
+    // while SQLite is busy the version is left unseen so the next tick tries again
+    if (journal->pendingCount() > 0 && !flushJournal()) return;
+    lastDataVersion = version;
+
+    // The log was compacted past our position, so incremental catch-up is impossible
+    qint64 oldest = Database::oldestChangeSeq();
+    if (oldest > lastChangeSeq + 1) {
+        qDebug() << "Change log compacted past seq" << lastChangeSeq << "- reloading";
+        transactionTable->setSortingEnabled(false);
+        loadTransactions();
+        transactionTable->setSortingEnabled(true);
+        return;
+    }
+
+    QVector<ChangeEntry> entries = Database::changesSince(lastChangeSeq);
+    if (entries.isEmpty()) return;
+
+    // Only the final state of each row matters
+    QSet<int> changedIds;
+    for (const ChangeEntry &entry : entries) {
+        changedIds.insert(entry.rowId);
+    }
+    lastChangeSeq = entries.last().seq;
+
+    QHash<int, int> rowsById;
+    for (int row = 0; row < transactionTable->rowCount(); ++row) {
+        QTableWidgetItem *idItem = transactionTable->item(row, 0);
+        if (idItem && changedIds.contains(idItem->text().toInt())) {
+            rowsById.insert(idItem->text().toInt(), row);
+        }
+    }
+
+    transactionTable->setSortingEnabled(false);
+    QList<int> rowsToRemove;
+    bool reloadPage = false;
+    for (int id : changedIds) {
+        TransactionRecord record;
+        bool exists = Database::fetchTransaction(id, &record);
+        int row = rowsById.value(id, -1);
+
+        // The table still holds the old values; the budgets table already has both sides applied by its triggers
+        if (row != -1) {
+            budgetEngine->refresh(transactionTable->item(row, 2)->text(), transactionTable->item(row, 1)->text().left(7));
+        }
+        if (exists) {
+            budgetEngine->refresh(record.category, record.date.toString("yyyy-MM"));
+        }
+
+        if (!exists) {
+            if (row != -1) rowsToRemove.append(row);
+            if (id == selectedTransactionId) clearForm();
+        } else if (row != -1) {
+            setTransactionRow(row, record);
+            transactionTable->setRowHidden(row, !matchesFilter(record));
+        } else if (pagedMode) {
+            // Whether an off-page row now belongs on the page depends on the filter and the row limit,
+            // so the page is queried again once instead of growing past rowLimit
+            reloadPage = true;
         } else {
-            typeItem->setForeground(QColor("red"));
+            row = transactionTable->rowCount();
+            transactionTable->insertRow(row);
+            setTransactionRow(row, record);
+            transactionTable->setRowHidden(row, !matchesFilter(record));
         }
+    }
+
+    // Remove bottom-up so earlier removals do not shift the remaining indexes
+    std::sort(rowsToRemove.begin(), rowsToRemove.end(), std::greater<int>());
+    for (int row : rowsToRemove) {
+        transactionTable->removeRow(row);
+    }
+    transactionTable->setSortingEnabled(true);
 
-        transactionTable->setItem(row, 5, typeItem); 
-        row++;
+    if (reloadPage) {
+        loadPage();
+        showScheduledRows();
     }
-    qDebug() << "Total rows loaded:" << row;
+
+    updateTableColors();
+    refreshChart();
+    ledgerColumnsDirty = true;
+    qDebug() << "Applied" << entries.size() << "change log entries for" << changedIds.size() << "rows";
 }
 
 void MainWindow::onTransactionSelected() {
     int currentRow = transactionTable->currentRow();  
 
-    if (currentRow == -1) {  
+    if (currentRow == -1 || isScheduledRow(currentRow)) {
         qDebug() << "No row selected.";
         clearForm();
         editButton->setEnabled(false);
@@ -372,6 +842,9 @@ void MainWindow::onTransactionSelected() {
     descriptionInput->setText(transactionTable->item(currentRow, 3)->text());
     amountInput->setText(transactionTable->item(currentRow, 4)->text());
     typeInput->setCurrentText(transactionTable->item(currentRow, 5)->text());
+    if (QTableWidgetItem *currencyItem = transactionTable->item(currentRow, 6)) {
+        currencyInput->setCurrentText(currencyItem->text());
+    }
 
     // Enable Edit and Delete buttons after selection
     editButton->setEnabled(true);
@@ -381,11 +854,11 @@ void MainWindow::onTransactionSelected() {
 void MainWindow::editTransaction() {
     if (selectedTransactionId == -1) return;
 
-    QString date = dateInput->date().toString("yyyy-MM-dd");
     QString category = categoryInput->currentText();
     QString description = descriptionInput->text();
     QString amountText = amountInput->text();
     QString type = typeInput->currentText();
+    QString currency = currencyInput->currentText();
 
     if (description.isEmpty() || amountText.isEmpty()) {
         QMessageBox::warning(this, "Input Error", "Please fill in all fields.");
@@ -399,9 +872,21 @@ void MainWindow::editTransaction() {
         return;
     }
 
-    if (Database::updateTransaction(selectedTransactionId, date, category, description, amount, type)) {
+    // The table is the current state; SQLite may not have the latest group commit yet
+    JournalEntry entry;
+    entry.kind = JournalEntry::Update;
+    if (!recordFromRow(rowForId(selectedTransactionId), &entry.before)) return;
+    entry.after = entry.before;
+    entry.after.date = dateInput->date();
+    entry.after.category = category;
+    entry.after.description = description;
+    entry.after.amount = amount;
+    entry.after.type = type;
+    entry.after.currency = currency;
+
+    if (journal->record(entry)) {
+        applyEntry(entry);
         QMessageBox::information(this, "Success", "Transaction updated successfully.");
-        loadTransactions();  
         clearForm();      
     } else {
         QMessageBox::critical(this, "Database Error", "Failed to update transaction.");
@@ -415,70 +900,549 @@ void MainWindow::deleteTransaction() {
     reply = QMessageBox::question(this, "Delete Transaction", "Are you sure you want to delete this transaction?",
                                   QMessageBox::Yes | QMessageBox::No);
     if (reply == QMessageBox::Yes) {
-        if (Database::deleteTransaction(selectedTransactionId)) {
-            loadTransactions();  
-            clearForm();         
+        JournalEntry entry;
+        entry.kind = JournalEntry::Remove;
+        if (!recordFromRow(rowForId(selectedTransactionId), &entry.before)) return;
+
+        if (journal->record(entry)) {
+            applyEntry(entry);
+            statusBar()->showMessage("Transaction deleted - Undo restores it", 5000);
         } else {
             QMessageBox::critical(this, "Database Error", "Failed to delete transaction.");
         }
     }
 }
 
-void MainWindow::applyFilters() {
-    QString searchTerm = searchInput->text().trimmed().toLower();
-    QString selectedCategory = filterCategory->currentText();
-    QString selectedType = filterType->currentText();
-    QDate startDate = filterStartDate->date();
-    QDate endDate = filterEndDate->date();
+// Folds the filter widgets and the free-form expression into one filter expression
+QString MainWindow::currentFilterText() const {
+    auto quote = [](QString value) {
+        value.replace("\\", "\\\\").replace("\"", "\\\"");
+        return "\"" + value + "\"";
+    };
 
-    // Iterate over all rows and apply filters
-    for (int row = 0; row < transactionTable->rowCount(); ++row) {
-        bool showRow = true;
+    QStringList clauses;
+    clauses << QString("date >= %1").arg(filterStartDate->date().toString("yyyy-MM-dd"))
+            << QString("date <= %1").arg(filterEndDate->date().toString("yyyy-MM-dd"));
+
+    QString searchTerm = searchInput->text().trimmed();
+    if (!searchTerm.isEmpty()) {
+        clauses << "desc ~ " + quote(searchTerm);
+    }
+    if (filterCategory->currentText() != "All Categories") {
+        clauses << "category = " + quote(filterCategory->currentText());
+    }
+    if (filterType->currentText() != "All Types") {
+        clauses << "type = " + quote(filterType->currentText());
+    }
+
+    QString expression = filterExpression->text().trimmed();
+    if (!expression.isEmpty()) {
+        clauses << "(" + expression + ")";
+    }
 
-        // Defensive Checks: Ensure all table items exist
-        QTableWidgetItem *dateItem = transactionTable->item(row, 1);
-        QTableWidgetItem *categoryItem = transactionTable->item(row, 2);
-        QTableWidgetItem *descriptionItem = transactionTable->item(row, 3);
-        QTableWidgetItem *amountItem = transactionTable->item(row, 4);
-        QTableWidgetItem *typeItem = transactionTable->item(row, 5);
+    return clauses.join(" and ");
+}
 
-        // If any critical data is missing, hide the row
-        if (!dateItem || !categoryItem || !descriptionItem || !amountItem || !typeItem) {
-            transactionTable->setRowHidden(row, true);
-            continue;  // Skip to the next row
+void MainWindow::applyFilters() {
+    QString error;
+    QSharedPointer<const FilterExpression> filter = FilterExpression::compile(currentFilterText(), &error);
+    if (!filter) {
+        filterExpression->setStyleSheet("border: 1px solid #F44336;");
+        filterExpression->setToolTip(error);
+        statusBar()->showMessage("Filter error: " + error, 5000);
+        return;
+    }
+    filterExpression->setStyleSheet("");
+    filterExpression->setToolTip(QString());
+    MemoryAccountant::touch("Filter cache");
+
+    // Over budget the table holds only a page, so the filter runs in SQLite and replaces the page
+    if (pagedMode) {
+        if (!flushJournal()) return;
+        // A new filter starts again from its newest match
+        QString filterText = currentFilterText();
+        if (filterText != pageFilterText) {
+            pageOffset = 0;
+            pageFilterText = filterText;
         }
+        pageFilter = filter;
+        loadPage();
+        showScheduledRows();
+        updateTableColors();
+        return;
+    }
 
-        // Filter by Date Range
-        QDate transactionDate = QDate::fromString(dateItem->text(), "yyyy-MM-dd");
-        if (!transactionDate.isValid() || transactionDate < startDate || transactionDate > endDate) {
-            showRow = false;
+    // The column copy is rebuilt only after the table content changes, not per keystroke
+    if (ledgerColumnsDirty) {
+        ledgerColumns.clear();
+        for (int row = 0; row < transactionTable->rowCount(); ++row) {
+            TransactionRecord record;
+            if (!recordFromRow(row, &record)) continue;
+            ledgerColumns.append(record);
         }
+        ledgerColumnsDirty = false;
+    }
+    MemoryAccountant::touch("Filter columns");
+
+    QVector<char> mask = filter->evaluate(ledgerColumns);
+    QSet<int> visibleIds;
+    visibleIds.reserve(ledgerColumns.size());
+    for (int i = 0; i < mask.size(); ++i) {
+        if (mask[i]) visibleIds.insert(ledgerColumns.ids[i]);
+    }
+
+    // Rows with missing or malformed data never match
+    for (int row = 0; row < transactionTable->rowCount(); ++row) {
+        QTableWidgetItem *idItem = transactionTable->item(row, 0);
+        transactionTable->setRowHidden(row, !idItem || !visibleIds.contains(idItem->text().toInt()));
+    }
+    showScheduledRows();
+
+    MemoryAccountant::enforce();
+}
+
+bool MainWindow::recordFromRow(int row, TransactionRecord *record) const {
+    if (isScheduledRow(row)) return false;
+    for (int col = 0; col < transactionTable->columnCount(); ++col) {
+        if (!transactionTable->item(row, col)) return false;
+    }
+
+    bool amountOk;
+    record->id = transactionTable->item(row, 0)->text().toInt();
+    record->date = QDate::fromString(transactionTable->item(row, 1)->text(), "yyyy-MM-dd");
+    record->category = transactionTable->item(row, 2)->text();
+    record->description = transactionTable->item(row, 3)->text();
+    record->amount = transactionTable->item(row, 4)->text().toDouble(&amountOk);
+    record->type = transactionTable->item(row, 5)->text();
+    record->currency = transactionTable->item(row, 6)->text();
+    return amountOk && record->date.isValid();
+}
+
+// Rows added or changed outside applyFilters get the same verdict it would give them
+bool MainWindow::matchesFilter(const TransactionRecord &record) const {
+    QSharedPointer<const FilterExpression> filter = FilterExpression::compile(currentFilterText());
+    if (!filter || filter->isEmpty()) return true;
+    return filter->evaluate(LedgerColumns::fromRecords({record})).first();
+}
 
-        // Filter by Search Term in Description
-        if (!descriptionItem->text().toLower().contains(searchTerm)) {
-            showRow = false;
+bool MainWindow::isScheduledRow(int row) const {
+    QTableWidgetItem *idItem = transactionTable->item(row, 0);
+    return idItem && idItem->data(Qt::UserRole).toBool();
+}
+
+// Occurrences recurring rules will book inside the viewed window. They are read-only and
+// never reach SQLite from here; materializeRecurring books them once they fall due.
+void MainWindow::showScheduledRows() {
+    bool sorting = transactionTable->isSortingEnabled();
+    transactionTable->setSortingEnabled(false);
+
+    for (int row = transactionTable->rowCount() - 1; row >= 0; --row) {
+        if (isScheduledRow(row)) transactionTable->removeRow(row);
+    }
+
+    // The same filter as the ledger rows, run over the expanded window
+    QSharedPointer<const FilterExpression> filter = FilterExpression::compile(currentFilterText());
+    QVector<TransactionRecord> upcoming;
+    if (filter) {
+        upcoming = recurrence.expand(filterStartDate->date(), filterEndDate->date());
+        MemoryAccountant::touch("Recurring windows");
+    }
+    QVector<char> mask = (!filter || filter->isEmpty()) ? QVector<char>(upcoming.size(), 1)
+                                                        : filter->evaluate(LedgerColumns::fromRecords(upcoming));
+
+    QFont scheduledFont = transactionTable->font();
+    scheduledFont.setItalic(true);
+    for (int i = 0; i < upcoming.size(); ++i) {
+        if (!mask[i]) continue;
+
+        int row = transactionTable->rowCount();
+        transactionTable->insertRow(row);
+        setTransactionRow(row, upcoming[i]);
+        transactionTable->item(row, 0)->setData(Qt::UserRole, true);
+        transactionTable->item(row, 3)->setText(upcoming[i].description + " (scheduled)");
+        for (int col = 0; col < transactionTable->columnCount(); ++col) {
+            QTableWidgetItem *item = transactionTable->item(row, col);
+            item->setFlags(Qt::ItemIsEnabled);
+            item->setFont(scheduledFont);
+            item->setForeground(QColor("#9E9E9E"));
+            item->setToolTip("Scheduled by a recurring rule; booked when it falls due");
         }
+    }
+
+    transactionTable->setSortingEnabled(sorting);
+}
 
-        // Filter by Category
-        if (selectedCategory != "All Categories" && categoryItem->text() != selectedCategory) {
-            showRow = false;
+void MainWindow::findDuplicates() {
+    if (!flushJournal()) return;
+    QVector<DuplicatePair> pairs = DuplicateFinder::findNearDuplicates(Database::fetchTransactions(QDate(), QDate()));
+
+    if (pairs.isEmpty()) {
+        QMessageBox::information(this, "Find Duplicates", "No duplicate transactions found.");
+        return;
+    }
+
+    QStringList lines;
+    int exactCount = 0;
+    for (const DuplicatePair &pair : pairs) {
+        if (pair.exact) exactCount++;
+        // Single multi-arg call so '%' in descriptions is never re-substituted
+        lines << QString("%1 #%2 %3 \"%4\"  <->  #%5 %6 \"%7\"  (%8 %9)")
+                     .arg(pair.exact ? QString("[exact]") : QString("[near] "),
+                          QString::number(pair.first.id), pair.first.date.toString("yyyy-MM-dd"), pair.first.description,
+                          QString::number(pair.second.id), pair.second.date.toString("yyyy-MM-dd"), pair.second.description,
+                          QString::number(pair.first.amount, 'f', 2), pair.first.type);
+    }
+
+    QMessageBox box(QMessageBox::Information, "Find Duplicates",
+                    QString("Found %1 candidate pairs (%2 exact).").arg(pairs.size()).arg(exactCount),
+                    QMessageBox::Ok, this);
+    box.setDetailedText(lines.join("\n"));
+    box.exec();
+}
+
+void MainWindow::archiveYear() {
+    bool ok;
+    int lastClosedYear = QDate::currentDate().year() - 1;
+    int year = QInputDialog::getInt(this, "Archive Year",
+                                    "Move all transactions of this closed year into a read-only archive.\n"
+                                    "Archived years stay available in reports but leave the main table.",
+                                    lastClosedYear, 1900, lastClosedYear, 1, &ok);
+    if (!ok) return;
+
+    if (Database::archivedYears().contains(year)) {
+        QMessageBox::information(this, "Archive Year", QString("%1 is already archived.").arg(year));
+        return;
+    }
+
+    if (!flushJournal()) {
+        QMessageBox::critical(this, "Archive Year", "Recent edits could not be saved yet, so nothing was archived. Try again shortly.");
+        return;
+    }
+    int archivedRows = 0;
+    if (Database::archiveYear(year, &archivedRows)) {
+        archivedTotalsLoaded = false;
+        recurrence.load();
+        loadTransactions();
+        QMessageBox::information(this, "Archive Year", QString("Archived %1 transactions from %2.").arg(archivedRows).arg(year));
+    } else {
+        QMessageBox::critical(this, "Database Error", QString("Failed to archive %1.").arg(year));
+    }
+}
+
+void MainWindow::exportArchive() {
+    bool ok;
+    int lastClosedYear = QDate::currentDate().year() - 1;
+    int year = QInputDialog::getInt(this, "Export Archive", "Closed year to export:", lastClosedYear, 1900, lastClosedYear, 1, &ok);
+    if (!ok) return;
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Export Archive", QString("transactions_%1.ftarc").arg(year),
+                                                    "Finance Archives (*.ftarc)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (!flushJournal()) {
+        QMessageBox::critical(this, "Export Archive", "Recent edits could not be saved yet, so nothing was exported. Try again shortly.");
+        return;
+    }
+    QVector<TransactionRecord> records = Database::fetchTransactions(QDate(year, 1, 1), QDate(year, 12, 31));
+    if (LedgerArchive::write(fileName, records)) {
+        QMessageBox::information(this, "Export Successful", QString("Exported %1 transactions from %2.").arg(records.size()).arg(year));
+    } else {
+        QMessageBox::warning(this, "Export Error", "Could not write the archive file.");
+    }
+}
+
+void MainWindow::editBudgets() {
+    bool ok;
+    QStringList categories;
+    for (int i = 0; i < categoryInput->count(); ++i) {
+        categories << categoryInput->itemText(i);
+    }
+
+    QString category = QInputDialog::getItem(this, "Budgets", "Category:", categories, 0, false, &ok);
+    if (!ok) return;
+
+    QString month = QDate::currentDate().toString("yyyy-MM");
+    QStringList unconverted;
+    double spent = budgetEngine->spent(category, month, &unconverted);
+    QString note = unconverted.isEmpty() ? QString()
+                                         : QString("\nNot counted, no FX rate: %1").arg(unconverted.join(", "));
+    double limit = QInputDialog::getDouble(this, "Budgets",
+                                           QString("Monthly limit for %1 in %3 (0 removes it).\nSpent this month: %2 %3%4")
+                                               .arg(category, QString::number(spent, 'f', 2), FxConverter::BaseCurrency, note),
+                                           budgetEngine->limit(category), 0, 1e9, 2, &ok);
+    if (!ok) return;
+
+    if (!budgetEngine->setLimit(category, limit)) {
+        QMessageBox::critical(this, "Database Error", "Failed to save budget.");
+    }
+}
+
+void MainWindow::onBudgetAlert(const QString &category, const QString &month, double spent, double limit, int level) {
+    QString message = QString("%1 budget for %2: %3 of %4 %5 spent")
+                          .arg(category, month, QString::number(spent, 'f', 2), QString::number(limit, 'f', 2), FxConverter::BaseCurrency);
+    qDebug() << "Budget alert:" << message;
+
+    if (level == BudgetEngine::OverLimit) {
+        statusBar()->showMessage("Over limit - " + message, 10000);
+    } else {
+        statusBar()->showMessage("Nearing limit - " + message, 10000);
+    }
+}
+
+void MainWindow::materializeRecurring() {
+    QVector<TransactionRecord> created = recurrence.materializeDue(QDate::currentDate());
+    if (created.isEmpty()) return;
+
+    // The budgets table was updated by its triggers; the in-memory totals take the same deltas
+    for (const TransactionRecord &record : created) {
+        budgetEngine->recordAdded(record);
+    }
+
+    transactionTable->setSortingEnabled(false);
+    loadTransactions();
+    transactionTable->setSortingEnabled(true);
+    statusBar()->showMessage(QString("Added %1 recurring transactions that fell due").arg(created.size()), 5000);
+}
+
+void MainWindow::editRecurring() {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Recurring Transactions");
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QTableWidget *rulesTable = new QTableWidget(&dialog);
+    rulesTable->setColumnCount(6);
+    rulesTable->setHorizontalHeaderLabels({"Description", "Category", "Amount", "Type", "Rule", "Next Due"});
+    rulesTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    rulesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    rulesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    rulesTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    layout->addWidget(rulesTable);
+
+    QLabel *upcomingLabel = new QLabel(&dialog);
+    layout->addWidget(upcomingLabel);
+
+    auto fillRules = [&]() {
+        QDate today = QDate::currentDate();
+        const QVector<RecurringRule> &rules = recurrence.rules();
+        rulesTable->setRowCount(rules.size());
+        for (int row = 0; row < rules.size(); ++row) {
+            const RecurringRule &rule = rules[row];
+            RecurrenceEngine::Pattern pattern;
+            RecurrenceEngine::parse(rule.rrule, &pattern);
+            QDate next = RecurrenceEngine::nextOccurrence(rule.startDate, pattern, today);
+
+            QTableWidgetItem *descriptionItem = new QTableWidgetItem(rule.description);
+            descriptionItem->setData(Qt::UserRole, rule.id);
+            rulesTable->setItem(row, 0, descriptionItem);
+            rulesTable->setItem(row, 1, new QTableWidgetItem(rule.category));
+            rulesTable->setItem(row, 2, new QTableWidgetItem(QString("%1 %2").arg(QString::number(rule.amount, 'f', 2), rule.currency)));
+            rulesTable->setItem(row, 3, new QTableWidgetItem(rule.type));
+            rulesTable->setItem(row, 4, new QTableWidgetItem(rule.rrule));
+            rulesTable->setItem(row, 5, new QTableWidgetItem(next.isValid() ? next.toString("yyyy-MM-dd") : QString("Ended")));
         }
 
-        // Filter by Type (Income/Expense)
-        if (selectedType != "All Types" && typeItem->text() != selectedType) {
-            showRow = false;
+        // Only the filter window is expanded, the same window the table is looking at
+        QVector<TransactionRecord> upcoming = recurrence.expand(filterStartDate->date(), filterEndDate->date());
+        upcomingLabel->setText(QString("%1 occurrences not yet booked between %2 and %3")
+                                   .arg(upcoming.size())
+                                   .arg(filterStartDate->date().toString("yyyy-MM-dd"), filterEndDate->date().toString("yyyy-MM-dd")));
+    };
+    fillRules();
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *addRuleButton = new QPushButton("Add Rule...", &dialog);
+    QPushButton *deleteRuleButton = new QPushButton("Delete Rule", &dialog);
+    QPushButton *closeButton = new QPushButton("Close", &dialog);
+    buttonLayout->addWidget(addRuleButton);
+    buttonLayout->addWidget(deleteRuleButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    layout->addLayout(buttonLayout);
+
+    connect(addRuleButton, &QPushButton::clicked, &dialog, [&]() {
+        RecurringRule rule;
+        if (!promptRecurringRule(&rule)) return;
+        if (!Database::addRecurringRule(rule)) {
+            QMessageBox::critical(&dialog, "Database Error", "Failed to save the recurring rule.");
+            return;
         }
+        recurrence.load();
+        materializeRecurring();
+        fillRules();
+    });
+
+    connect(deleteRuleButton, &QPushButton::clicked, &dialog, [&]() {
+        int row = rulesTable->currentRow();
+        if (row == -1) return;
 
-        // Filter by Valid Amount (Handle invalid numbers safely)
-        bool ok;
-        double amount = amountItem->text().toDouble(&ok);
-        if (!ok) {
-            showRow = false;  // Hide rows with invalid amounts
+        // Rows already booked from the rule stay; only future occurrences go away
+        int id = rulesTable->item(row, 0)->data(Qt::UserRole).toInt();
+        if (QMessageBox::question(&dialog, "Delete Rule", "Stop this recurring transaction? Booked transactions are kept.",
+                                  QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+            return;
         }
+        if (!Database::deleteRecurringRule(id)) {
+            QMessageBox::critical(&dialog, "Database Error", "Failed to delete the recurring rule.");
+            return;
+        }
+        recurrence.load();
+        fillRules();
+    });
 
-        // Apply final visibility
-        transactionTable->setRowHidden(row, !showRow);
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+
+    dialog.resize(750, 400);
+    dialog.exec();
+
+    // Rules may have been added or removed, which changes the scheduled rows in the viewed window
+    showScheduledRows();
+    updateTableColors();
+}
+
+bool MainWindow::promptRecurringRule(RecurringRule *rule) {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Add Recurring Rule");
+    QFormLayout *form = new QFormLayout(&dialog);
+
+    QLineEdit *description = new QLineEdit(&dialog);
+    form->addRow("Description:", description);
+
+    QStringList categories;
+    for (int i = 0; i < categoryInput->count(); ++i) {
+        categories << categoryInput->itemText(i);
+    }
+    QComboBox *category = new QComboBox(&dialog);
+    category->addItems(categories);
+    form->addRow("Category:", category);
+
+    QComboBox *type = new QComboBox(&dialog);
+    type->addItems({"Expense", "Income"});
+    form->addRow("Type:", type);
+
+    QDoubleSpinBox *amount = new QDoubleSpinBox(&dialog);
+    amount->setRange(0.01, 1e9);
+    amount->setDecimals(2);
+    form->addRow("Amount:", amount);
+
+    QComboBox *currency = new QComboBox(&dialog);
+    currency->addItems({"EUR", "USD", "SEK"});
+    form->addRow("Currency:", currency);
+
+    QDateEdit *start = createDateEdit(QDate::currentDate());
+    form->addRow("First date:", start);
+
+    QComboBox *frequency = new QComboBox(&dialog);
+    frequency->addItems({"Daily", "Weekly", "Monthly", "Yearly"});
+    frequency->setCurrentIndex(RecurrenceEngine::Monthly);
+    form->addRow("Repeats:", frequency);
+
+    QSpinBox *interval = new QSpinBox(&dialog);
+    interval->setRange(1, 365);
+    form->addRow("Every:", interval);
+
+    QSpinBox *count = new QSpinBox(&dialog);
+    count->setRange(0, 10000);
+    count->setSpecialValueText("No end");
+    form->addRow("Occurrences:", count);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+
+    if (dialog.exec() != QDialog::Accepted) return false;
+
+    if (description->text().trimmed().isEmpty()) {
+        QMessageBox::warning(this, "Input Error", "Please enter a description.");
+        return false;
+    }
+
+    QString rrule = QString("FREQ=%1;INTERVAL=%2").arg(frequency->currentText().toUpper()).arg(interval->value());
+    if (count->value() > 0) {
+        rrule += QString(";COUNT=%1").arg(count->value());
+    }
+
+    rule->description = description->text().trimmed();
+    rule->category = category->currentText();
+    rule->type = type->currentText();
+    rule->amount = amount->value();
+    rule->currency = currency->currentText();
+    rule->startDate = start->date();
+    rule->rrule = rrule;
+    return true;
+}
+
+void MainWindow::importFxRates() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Import FX Rates", "", "CSV Files (*.csv)");
+    if (fileName.isEmpty()) {
+        return;
     }
+
+    int imported = Database::importFxRates(fileName);
+    if (imported < 0) {
+        QMessageBox::warning(this, "Import Error", "Could not import the rate file.");
+        return;
+    }
+
+    reportsPanel->reloadRates();
+    budgetEngine->reloadRates();
+    chartFx.load();
+    refreshChart();
+    QMessageBox::information(this, "Import Successful",
+                             QString("Imported %1 rates. Expected lines: date,currency,rate (EUR per unit).").arg(imported));
+}
+
+void MainWindow::showDiagnostics() {
+    QDialog dialog(this);
+    dialog.setWindowTitle("Memory Diagnostics");
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QTableWidget *usageTable = new QTableWidget(&dialog);
+    usageTable->setColumnCount(3);
+    usageTable->setHorizontalHeaderLabels({"Structure", "Estimated Size", "Evictable"});
+    usageTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    usageTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    qint64 total = 0;
+    QVector<MemoryAccountant::Usage> usages = MemoryAccountant::snapshot();
+    usageTable->setRowCount(usages.size());
+    for (int row = 0; row < usages.size(); ++row) {
+        usageTable->setItem(row, 0, new QTableWidgetItem(usages[row].name));
+        usageTable->setItem(row, 1, new QTableWidgetItem(MemoryAccountant::formatBytes(usages[row].bytes)));
+        usageTable->setItem(row, 2, new QTableWidgetItem(usages[row].evictable ? "Yes" : "No"));
+        total += usages[row].bytes;
+    }
+    layout->addWidget(usageTable);
+
+    QString rows = pagedMode ? QString("a page of %1 of %2 rows loaded").arg(transactionTable->rowCount()).arg(Database::transactionCount())
+                             : QString("all %1 rows loaded").arg(transactionTable->rowCount());
+    layout->addWidget(new QLabel(QString("Total: %1 (%2)").arg(MemoryAccountant::formatBytes(total), rows), &dialog));
+
+    QHBoxLayout *budgetLayout = new QHBoxLayout();
+    budgetLayout->addWidget(new QLabel("Memory budget (MB):", &dialog));
+    QSpinBox *budgetInput = new QSpinBox(&dialog);
+    budgetInput->setRange(16, 65536);
+    budgetInput->setValue(static_cast<int>(MemoryAccountant::budget() / (1024 * 1024)));
+    budgetLayout->addWidget(budgetInput);
+    layout->addLayout(budgetLayout);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    dialog.resize(450, 350);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    qint64 budget = static_cast<qint64>(budgetInput->value()) * 1024 * 1024;
+    if (budget == MemoryAccountant::budget()) return;
+
+    MemoryAccountant::setBudget(budget);
+    transactionTable->setSortingEnabled(false);
+    loadTransactions();
+    transactionTable->setSortingEnabled(true);
 }
 
 void MainWindow::exportToCSV() {
@@ -496,16 +1460,18 @@ void MainWindow::exportToCSV() {
 
     QTextStream out(&file);
 
-    out << "Date,Category,Description,Amount,Type\n";
+    out << "Date,Category,Description,Amount,Type,Currency\n";
 
     for (int row = 0; row < transactionTable->rowCount(); ++row) {
+        if (isScheduledRow(row)) continue;
         QString date = transactionTable->item(row, 1)->text();
         QString category = transactionTable->item(row, 2)->text();
         QString description = transactionTable->item(row, 3)->text().replace(",", " "); 
         QString amount = transactionTable->item(row, 4)->text();
         QString type = transactionTable->item(row, 5)->text();
+        QString currency = transactionTable->item(row, 6)->text();
 
-        out << QString("%1,%2,%3,%4,%5\n").arg(date, category, description, amount, type);
+        out << QString("%1,%2,%3,%4,%5,%6\n").arg(date, category, description, amount, type, currency);
     }
 
     file.close();
@@ -662,6 +1628,7 @@ QString MainWindow::getDarkModeStyle() {
 
 void MainWindow::updateTableColors() {
     for (int row = 0; row < transactionTable->rowCount(); ++row) {
+        bool scheduled = isScheduledRow(row);
         for (int col = 0; col < transactionTable->columnCount(); ++col) {
             QTableWidgetItem *item = transactionTable->item(row, col);
 
@@ -679,8 +1646,10 @@ void MainWindow::updateTableColors() {
                     item->setBackground(QBrush(Qt::transparent));
                 }
 
-                // Preserve Income/Expense colors in the Type column (column 5)
-                if (col == 5) {
+                // Scheduled rows stay greyed out; otherwise preserve Income/Expense colors in the Type column (column 5)
+                if (scheduled) {
+                    item->setForeground(QColor("#9E9E9E"));
+                } else if (col == 5) {
                     QString type = item->text();
                     if (type == "Income") {
                         item->setForeground(QColor("#00C853"));  // Darker green for Income
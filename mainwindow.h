@@ -7,9 +7,19 @@
 #include <QComboBox>
 #include <QDateEdit>
 #include <QPushButton>
+#include <QLabel>
 #include <QShortcut>
 #include <QMap>
 #include "customtablewidget.h"
+#include "database.h"
+#include "filterexpression.h"
+#include "editjournal.h"
+#include "recurrenceengine.h"
+#include "fxconverter.h"
+
+class ReportsPanel;
+class BudgetEngine;
+class SpendingChart;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -28,6 +38,20 @@ private slots:
     void applyFilters(); 
     void clearFilters(); 
     void exportToCSV();
+    void findDuplicates();
+    void archiveYear();
+    void exportArchive();
+    void pollChanges();
+    void showNewerPage();
+    void showOlderPage();
+    void editBudgets();
+    void importFxRates();
+    void showDiagnostics();
+    void undoEdit();
+    void redoEdit();
+    void editRecurring();
+    void materializeRecurring();
+    void onBudgetAlert(const QString &category, const QString &month, double spent, double limit, int level);
     void sortTable(int column);
     void updateHeaderArrows(int sortedColumn, bool ascending);
     void highlightSortedColumn();
@@ -36,19 +60,51 @@ private slots:
 
 private:
     void setupUI();
+    void setTransactionRow(int row, const TransactionRecord &record);
+    void populateTable(const QVector<TransactionRecord> &records);
+    QVector<TransactionRecord> loadPage();
+    void applyEntry(const JournalEntry &entry);
+    void refreshChart();
+    int rowForId(int id) const;
+    bool flushJournal();
+    bool recordFromRow(int row, TransactionRecord *record) const;
+    void showScheduledRows();
+    bool isScheduledRow(int row) const;
+    bool matchesFilter(const TransactionRecord &record) const;
+    QString currentFilterText() const;
+    bool promptRecurringRule(RecurringRule *rule);
 
     // Form Inputs
     QLineEdit *descriptionInput;
     QComboBox *categoryInput;
     QComboBox *typeInput; 
     QLineEdit *amountInput;
+    QComboBox *currencyInput;
     QDateEdit *dateInput;
     QPushButton *addButton;
     QPushButton *editButton;    
     QPushButton *deleteButton; 
+    QPushButton *undoButton;
+    QPushButton *redoButton;
 
     // Table 
     CustomTableWidget *transactionTable;
+    SpendingChart *spendingChart;
+    FxConverter chartFx;  // the chart plots every currency in the base currency
+    QVector<DailyTotal> archivedTotals;  // archives are frozen, so read once and again after archiving
+    bool archivedTotalsLoaded = false;
+
+    // Reports
+    ReportsPanel *reportsPanel;
+
+    // Budgets
+    BudgetEngine *budgetEngine;
+
+    // Form edits reach SQLite through the journal in group commits
+    EditJournal *journal;
+
+    // Recurring rules, expanded per viewed window and written out as they fall due
+    RecurrenceEngine recurrence;
 
     // Filter & Search Elements
     QLineEdit *searchInput;        
@@ -56,13 +112,34 @@ private:
     QComboBox *filterType;         
     QDateEdit *filterStartDate;    
     QDateEdit *filterEndDate;    
+    QLineEdit *filterExpression;
     QShortcut *sortByDateShortcut;
     QShortcut *sortByAmountShortcut;  
     QMap<int, bool> columnSortOrder;
 
+    // Column copy of the loaded rows for the filter predicate program
+    LedgerColumns ledgerColumns;
+    bool ledgerColumnsDirty = true;
+
     int selectedTransactionId = -1;
     int lastSelectedRow = -1;     
     int currentSortedColumn = -1;  
+
+    // Memory budget: past the row limit the table holds one page of rows and filters query SQLite
+    bool pagedMode = false;
+    int rowLimit = 0;
+    qint64 averageRowBytes = 0;
+    int pageOffset = 0;                                 // matching rows newer than the page
+    QSharedPointer<const FilterExpression> pageFilter;  // null while the page is unfiltered
+    QString pageFilterText;
+    QWidget *pageControls;
+    QPushButton *newerPageButton;
+    QPushButton *olderPageButton;
+    QLabel *pageLabel;
+
+    // Cross-process refresh state
+    qint64 lastChangeSeq = 0;
+    qint64 lastDataVersion = -1;
  
     bool dateSortAscending = true;    
     bool amountSortAscending = true;  
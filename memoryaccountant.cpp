@@ -0,0 +1,146 @@
+#include "memoryaccountant.h"
+#include <QSettings>
+#include <QStringList>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+struct Consumer {
+    QString name;
+    std::function<qint64()> usage;
+    std::function<void()> evict;
+    quint64 lastUsed = 0;
+};
+
+QVector<Consumer> &consumers() {
+    static QVector<Consumer> registry;
+    return registry;
+}
+
+quint64 nextTick() {
+    static quint64 tick = 0;
+    return ++tick;
+}
+
+qint64 cachedBudget = -1;
+
+}
+
+void MemoryAccountant::registerConsumer(const QString &name, std::function<qint64()> usage, std::function<void()> evict) {
+    unregisterConsumer(name);
+
+    Consumer consumer;
+    consumer.name = name;
+    consumer.usage = usage;
+    consumer.evict = evict;
+    consumer.lastUsed = nextTick();
+    consumers().append(consumer);
+}
+
+void MemoryAccountant::unregisterConsumer(const QString &name) {
+    QVector<Consumer> &registry = consumers();
+    for (int i = 0; i < registry.size(); ++i) {
+        if (registry[i].name == name) {
+            registry.remove(i);
+            return;
+        }
+    }
+}
+
+void MemoryAccountant::touch(const QString &name) {
+    for (Consumer &consumer : consumers()) {
+        if (consumer.name == name) {
+            consumer.lastUsed = nextTick();
+            return;
+        }
+    }
+}
+
+QVector<MemoryAccountant::Usage> MemoryAccountant::snapshot() {
+    QVector<Usage> usages;
+    for (const Consumer &consumer : consumers()) {
+        Usage usage;
+        usage.name = consumer.name;
+        usage.bytes = consumer.usage();
+        usage.evictable = static_cast<bool>(consumer.evict);
+        usages.append(usage);
+    }
+    return usages;
+}
+
+qint64 MemoryAccountant::totalUsage() {
+    qint64 total = 0;
+    for (const Consumer &consumer : consumers()) {
+        total += consumer.usage();
+    }
+    return total;
+}
+
+qint64 MemoryAccountant::unevictableUsage() {
+    qint64 total = 0;
+    for (const Consumer &consumer : consumers()) {
+        if (!consumer.evict) total += consumer.usage();
+    }
+    return total;
+}
+
+qint64 MemoryAccountant::budget() {
+    if (cachedBudget < 0) {
+        QSettings settings("Jonevs", "FinanceTracker");
+        cachedBudget = settings.value("memory/budgetBytes", DefaultBudget).toLongLong();
+    }
+    return cachedBudget;
+}
+
+void MemoryAccountant::setBudget(qint64 bytes) {
+    cachedBudget = bytes;
+    QSettings settings("Jonevs", "FinanceTracker");
+    settings.setValue("memory/budgetBytes", bytes);
+}
+
+qint64 MemoryAccountant::enforce() {
+    qint64 limit = budget();
+    qint64 before = totalUsage();
+    if (before <= limit) return 0;
+
+    QVector<Consumer *> candidates;
+    for (Consumer &consumer : consumers()) {
+        if (consumer.evict) candidates.append(&consumer);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Consumer *a, const Consumer *b) {
+        return a->lastUsed < b->lastUsed;
+    });
+
+    qint64 total = before;
+    for (Consumer *consumer : candidates) {
+        if (total <= limit) break;
+        qint64 size = consumer->usage();
+        if (size == 0) continue;
+
+        consumer->evict();
+        total = totalUsage();
+        qDebug() << "Memory budget exceeded: evicted" << consumer->name << "(" << formatBytes(size) << ")";
+    }
+
+    if (total > limit) {
+        qDebug() << "Memory still over budget after evicting caches:" << formatBytes(total) << "of" << formatBytes(limit);
+    }
+    return before - total;
+}
+
+void MemoryAccountant::logUsage() {
+    QStringList parts;
+    qint64 total = 0;
+    for (const Usage &usage : snapshot()) {
+        parts << QString("%1 %2").arg(usage.name, formatBytes(usage.bytes));
+        total += usage.bytes;
+    }
+    qDebug().noquote() << QString("Memory: %1 of %2 budget (%3)").arg(formatBytes(total), formatBytes(budget()), parts.join(", "));
+}
+
+QString MemoryAccountant::formatBytes(qint64 bytes) {
+    if (bytes >= 1024 * 1024) return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+    if (bytes >= 1024) return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    return QString::number(bytes) + " B";
+}
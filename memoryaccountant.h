@@ -0,0 +1,41 @@
+#ifndef MEMORYACCOUNTANT_H
+#define MEMORYACCOUNTANT_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// Registry of in-memory structures and their estimated footprint.
+// Owners register a usage callback and, for caches and derived indexes, an
+// eviction callback. When the total exceeds the configured budget, the
+// least recently used evictable consumers are dropped first.
+class MemoryAccountant {
+public:
+    struct Usage {
+        QString name;
+        qint64 bytes = 0;
+        bool evictable = false;
+    };
+
+    static void registerConsumer(const QString &name, std::function<qint64()> usage, std::function<void()> evict = nullptr);
+    static void unregisterConsumer(const QString &name);
+    static void touch(const QString &name);
+
+    static QVector<Usage> snapshot();
+    static qint64 totalUsage();
+    static qint64 unevictableUsage();
+
+    // Budget in bytes, persisted in the application settings
+    static qint64 budget();
+    static void setBudget(qint64 bytes);
+
+    // Evicts LRU caches until the total fits; returns the number of bytes freed
+    static qint64 enforce();
+    static void logUsage();
+
+    static QString formatBytes(qint64 bytes);
+
+    static constexpr qint64 DefaultBudget = 256LL * 1024 * 1024;
+};
+
+#endif
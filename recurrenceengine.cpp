@@ -0,0 +1,274 @@
+#include "recurrenceengine.h"
+#include <QDebug>
+#include <QStringList>
+#include <algorithm>
+
+bool RecurrenceEngine::parse(const QString &rrule, Pattern *pattern, QString *error) {
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    Pattern result;
+    bool hasFrequency = false;
+
+    for (const QString &part : rrule.trimmed().split(';', QString::SkipEmptyParts)) {
+        int equals = part.indexOf('=');
+        if (equals <= 0) return fail(QString("Expected NAME=VALUE, got \"%1\"").arg(part));
+
+        QString name = part.left(equals).trimmed().toUpper();
+        QString value = part.mid(equals + 1).trimmed().toUpper();
+        bool ok = true;
+
+        if (name == "FREQ") {
+            static const QStringList frequencies = {"DAILY", "WEEKLY", "MONTHLY", "YEARLY"};
+            int index = frequencies.indexOf(value);
+            if (index == -1) return fail("FREQ must be DAILY, WEEKLY, MONTHLY or YEARLY");
+            result.frequency = static_cast<Frequency>(index);
+            hasFrequency = true;
+        } else if (name == "INTERVAL") {
+            result.interval = value.toInt(&ok);
+            if (!ok || result.interval < 1) return fail("INTERVAL must be a positive number");
+        } else if (name == "COUNT") {
+            result.count = value.toInt(&ok);
+            if (!ok || result.count < 1) return fail("COUNT must be a positive number");
+        } else if (name == "UNTIL") {
+            // Date-only UNTIL; a time part is ignored since transactions have no time of day
+            result.until = QDate::fromString(value.left(8), "yyyyMMdd");
+            if (!result.until.isValid()) result.until = QDate::fromString(value, "yyyy-MM-dd");
+            if (!result.until.isValid()) return fail("UNTIL must be a date like 20251231");
+        } else if (name == "BYMONTHDAY") {
+            result.monthDay = value.toInt(&ok);
+            if (!ok || result.monthDay < 1 || result.monthDay > 31) return fail("BYMONTHDAY must be between 1 and 31");
+        } else {
+            return fail(QString("Unsupported rule part %1").arg(name));
+        }
+    }
+
+    if (!hasFrequency) return fail("FREQ is required");
+    if (result.monthDay > 0 && result.frequency != Monthly) return fail("BYMONTHDAY is only supported with FREQ=MONTHLY");
+
+    *pattern = result;
+    return true;
+}
+
+// Days past the end of a short month clamp to its last day, so rent on the 31st still lands in February
+QDate RecurrenceEngine::occurrence(const QDate &start, const Pattern &pattern, qint64 index) {
+    switch (pattern.frequency) {
+    case Daily:
+        return start.addDays(index * pattern.interval);
+    case Weekly:
+        return start.addDays(index * pattern.interval * 7);
+    case Monthly:
+    case Yearly: {
+        qint64 months = index * pattern.interval * (pattern.frequency == Yearly ? 12 : 1);
+        QDate month = QDate(start.year(), start.month(), 1).addMonths(static_cast<int>(months));
+        int day = pattern.monthDay > 0 ? pattern.monthDay : start.day();
+        return QDate(month.year(), month.month(), qMin(day, month.daysInMonth()));
+    }
+    }
+    return QDate();
+}
+
+QVector<QDate> RecurrenceEngine::occurrences(const QDate &start, const Pattern &pattern, const QDate &from, const QDate &to) {
+    QVector<QDate> dates;
+    if (!start.isValid() || !from.isValid() || !to.isValid()) return dates;
+
+    QDate begin = qMax(from, start);
+    QDate last = pattern.until.isValid() ? qMin(to, pattern.until) : to;
+    if (begin > last) return dates;
+
+    // With BYMONTHDAY the first period can fall before the start date; COUNT starts at the first real occurrence
+    qint64 first = occurrence(start, pattern, 0) < start ? 1 : 0;
+
+    // Jump to just before the window instead of walking from the start date
+    qint64 index = 0;
+    switch (pattern.frequency) {
+    case Daily:
+        index = start.daysTo(begin) / pattern.interval;
+        break;
+    case Weekly:
+        index = start.daysTo(begin) / (7 * pattern.interval);
+        break;
+    case Monthly:
+    case Yearly: {
+        qint64 months = (begin.year() - start.year()) * 12 + begin.month() - start.month();
+        index = months / (pattern.interval * (pattern.frequency == Yearly ? 12 : 1)) - 1;
+        break;
+    }
+    }
+    index = qMax(index, first);
+
+    while (occurrence(start, pattern, index) < begin) {
+        ++index;
+    }
+
+    for (; pattern.count == 0 || index < first + pattern.count; ++index) {
+        QDate date = occurrence(start, pattern, index);
+        if (date > last) break;
+        dates.append(date);
+    }
+    return dates;
+}
+
+QDate RecurrenceEngine::nextOccurrence(const QDate &start, const Pattern &pattern, const QDate &after) {
+    if (!start.isValid() || !after.isValid()) return QDate();
+    QDate from = qMax(after.addDays(1), start);
+
+    // Consecutive occurrences are at most one period apart, plus the days a month-end clamp can shift
+    QDate to;
+    switch (pattern.frequency) {
+    case Daily:
+        to = from.addDays(pattern.interval);
+        break;
+    case Weekly:
+        to = from.addDays(7 * pattern.interval);
+        break;
+    case Monthly:
+    case Yearly:
+        to = from.addMonths(pattern.interval * (pattern.frequency == Yearly ? 12 : 1));
+        to = QDate(to.year(), to.month(), to.daysInMonth());
+        break;
+    }
+
+    QVector<QDate> dates = occurrences(start, pattern, from, to);
+    return dates.isEmpty() ? QDate() : dates.first();
+}
+
+void RecurrenceEngine::load() {
+    ruleList.clear();
+    patterns.clear();
+
+    for (const RecurringRule &rule : Database::recurringRules()) {
+        Pattern pattern;
+        QString error;
+        if (!parse(rule.rrule, &pattern, &error) || !rule.startDate.isValid()) {
+            qDebug() << "Skipping recurring rule" << rule.id << ":" << (error.isEmpty() ? "invalid start date" : error);
+            continue;
+        }
+        ruleList.append(rule);
+        patterns.append(pattern);
+    }
+    closedYears = archivedYearSet();
+
+    clearCache();
+}
+
+QSet<int> RecurrenceEngine::archivedYearSet() {
+    QSet<int> years;
+    for (int year : Database::archivedYears()) {
+        years.insert(year);
+    }
+    return years;
+}
+
+TransactionRecord RecurrenceEngine::recordFor(const RecurringRule &rule, const QDate &date) {
+    TransactionRecord record;
+    record.date = date;
+    record.category = rule.category;
+    record.description = rule.description;
+    record.amount = rule.amount;
+    record.type = rule.type;
+    record.currency = rule.currency;
+    return record;
+}
+
+QVector<TransactionRecord> RecurrenceEngine::expand(const QDate &from, const QDate &to) {
+    QPair<qint64, qint64> key(from.toJulianDay(), to.toJulianDay());
+    auto cached = windowCache.constFind(key);
+    if (cached != windowCache.constEnd()) {
+        windowOrder.removeOne(key);
+        windowOrder.append(key);
+        return cached.value();
+    }
+
+    QVector<TransactionRecord> records;
+    for (int i = 0; i < ruleList.size(); ++i) {
+        const RecurringRule &rule = ruleList[i];
+
+        // Materialized occurrences are ordinary transactions by now
+        QDate begin = from;
+        if (rule.materializedThrough.isValid() && rule.materializedThrough >= begin) {
+            begin = rule.materializedThrough.addDays(1);
+        }
+
+        for (const QDate &date : occurrences(rule.startDate, patterns[i], begin, to)) {
+            if (!closedYears.contains(date.year())) records.append(recordFor(rule, date));
+        }
+    }
+
+    std::stable_sort(records.begin(), records.end(), [](const TransactionRecord &a, const TransactionRecord &b) {
+        return a.date < b.date;
+    });
+
+    if (windowCache.size() >= MaxCachedWindows && !windowOrder.isEmpty()) {
+        windowCache.remove(windowOrder.takeFirst());
+    }
+    windowCache.insert(key, records);
+    windowOrder.append(key);
+    return records;
+}
+
+QVector<TransactionRecord> RecurrenceEngine::materializeDue(const QDate &today) {
+    QVector<TransactionRecord> created;
+    bool stale = false;
+
+    // A year may have been archived since load, possibly by another process
+    QSet<int> archived = archivedYearSet();
+    if (archived != closedYears) {
+        closedYears = archived;
+        clearCache();
+    }
+
+    for (int i = 0; i < ruleList.size(); ++i) {
+        RecurringRule &rule = ruleList[i];
+        QDate from = rule.materializedThrough.isValid() ? rule.materializedThrough.addDays(1) : rule.startDate;
+        if (from > today) continue;
+
+        // Rules with nothing due are left untouched, so an idle check costs no writes
+        QVector<QDate> dates = occurrences(rule.startDate, patterns[i], from, today);
+        if (dates.isEmpty()) continue;
+
+        // The marker still advances past skipped occurrences, so they are never booked later
+        QVector<TransactionRecord> records;
+        for (const QDate &date : dates) {
+            if (!closedYears.contains(date.year())) records.append(recordFor(rule, date));
+        }
+
+        if (!Database::materializeRule(rule.id, rule.materializedThrough, today, records)) {
+            stale = true;
+            continue;
+        }
+        rule.materializedThrough = today;
+        created += records;
+    }
+
+    // Another process may have materialized some rules first; pick up its markers
+    if (stale) {
+        load();
+    } else if (!created.isEmpty()) {
+        clearCache();
+    }
+
+    if (!created.isEmpty()) {
+        qDebug() << "Materialized" << created.size() << "recurring transactions due by" << today.toString("yyyy-MM-dd");
+    }
+    return created;
+}
+
+void RecurrenceEngine::clearCache() {
+    windowCache.clear();
+    windowOrder.clear();
+}
+
+qint64 RecurrenceEngine::memoryUsage() const {
+    // Record strings are shared with the rules they came from, so only the rules carry string data
+    qint64 bytes = ruleList.capacity() * sizeof(RecurringRule) + patterns.capacity() * sizeof(Pattern);
+    for (const RecurringRule &rule : ruleList) {
+        bytes += (rule.description.capacity() + rule.category.capacity() + rule.rrule.capacity()) * sizeof(QChar);
+    }
+    for (auto it = windowCache.constBegin(); it != windowCache.constEnd(); ++it) {
+        bytes += it.value().capacity() * sizeof(TransactionRecord) + 2 * sizeof(void *) + sizeof(it.key());
+    }
+    return bytes;
+}
@@ -0,0 +1,59 @@
+#ifndef RECURRENCEENGINE_H
+#define RECURRENCEENGINE_H
+
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "database.h"
+
+// Expands recurring rules on demand. Occurrence k of a rule is computed
+// directly from its start date, so a window costs only the occurrences inside
+// it. Expanded windows are cached until the rules change, and occurrences are
+// written to transactions only once they fall due.
+class RecurrenceEngine {
+public:
+    enum Frequency { Daily, Weekly, Monthly, Yearly };
+
+    struct Pattern {
+        Frequency frequency = Monthly;
+        int interval = 1;
+        int count = 0;  // 0 repeats without limit
+        QDate until;
+        int monthDay = 0;  // BYMONTHDAY; 0 keeps the start date's day
+    };
+
+    static bool parse(const QString &rrule, Pattern *pattern, QString *error = nullptr);
+    static QVector<QDate> occurrences(const QDate &start, const Pattern &pattern, const QDate &from, const QDate &to);
+    // First occurrence strictly after the given day; invalid once COUNT or UNTIL has ended the rule
+    static QDate nextOccurrence(const QDate &start, const Pattern &pattern, const QDate &after);
+
+    void load();
+    const QVector<RecurringRule> &rules() const { return ruleList; }
+
+    // Occurrences in [from, to] that are not materialized yet, as records with id -1, oldest first
+    QVector<TransactionRecord> expand(const QDate &from, const QDate &to);
+    // Writes every occurrence up to today into transactions and returns the new rows.
+    // Occurrences in archived years are skipped: those years are closed and read-only.
+    QVector<TransactionRecord> materializeDue(const QDate &today);
+
+    void clearCache();
+    qint64 memoryUsage() const;
+
+    static const int MaxCachedWindows = 16;
+
+private:
+    static QDate occurrence(const QDate &start, const Pattern &pattern, qint64 index);
+    static TransactionRecord recordFor(const RecurringRule &rule, const QDate &date);
+    static QSet<int> archivedYearSet();
+
+    QVector<RecurringRule> ruleList;
+    QVector<Pattern> patterns;  // parallel to ruleList; invalid rules are dropped on load
+    QSet<int> closedYears;      // archived years, which never get occurrences
+
+    QHash<QPair<qint64, qint64>, QVector<TransactionRecord>> windowCache;
+    QVector<QPair<qint64, qint64>> windowOrder;  // least recently used first
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "reportengine.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+
+QFuture<Report> ReportEngine::run(const QVector<TransactionRecord> &records) {
+    QSharedPointer<const QVector<TransactionRecord>> shared(new QVector<TransactionRecord>(records));
+
+    // A few chunks per core keeps every worker busy when months are unevenly sized
+    int chunkCount = qMax(1, QThread::idealThreadCount() * 4);
+    QVector<ReportChunk> chunks = partition(shared, chunkCount);
+
+    return QtConcurrent::mappedReduced<Report>(chunks, &ReportEngine::aggregateChunk, &ReportEngine::mergeReports,
+                                               QtConcurrent::UnorderedReduce);
+}
+
+QVector<ReportChunk> ReportEngine::partition(const QSharedPointer<const QVector<TransactionRecord>> &records, int chunkCount) {
+    QVector<ReportChunk> chunks;
+    const QVector<TransactionRecord> &rows = *records;
+    int total = rows.size();
+    if (total == 0) return chunks;
+
+    int target = qMax(1, total / qMax(1, chunkCount));
+    int begin = 0;
+
+    while (begin < total) {
+        int end = qMin(total, begin + target);
+
+        // Move the cut forward to the next month boundary so chunks cover disjoint date ranges
+        while (end < total && end > begin
+               && rows[end].date.year() == rows[end - 1].date.year()
+               && rows[end].date.month() == rows[end - 1].date.month()) {
+            ++end;
+        }
+
+        ReportChunk chunk;
+        chunk.records = records;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.append(chunk);
+        begin = end;
+    }
+
+    return chunks;
+}
+
+Report ReportEngine::aggregateChunk(const ReportChunk &chunk) {
+    Report partial;
+    const QVector<TransactionRecord> &rows = *chunk.records;
+
+    QString currentMonth;
+    MonthlyTotals *monthTotals = nullptr;
+
+    for (int i = chunk.begin; i < chunk.end; ++i) {
+        const TransactionRecord &record = rows[i];
+
+        // Rows are date-sorted, so the month entry only changes at boundaries
+        QString month = record.date.toString("yyyy-MM");
+        if (!monthTotals || month != currentMonth) {
+            currentMonth = month;
+            monthTotals = &partial.monthly[month];
+        }
+
+        if (record.type == "Income") {
+            monthTotals->income += record.amount;
+        } else {
+            monthTotals->expense += record.amount;
+            partial.categoryTotals[record.category] += record.amount;
+        }
+
+        DescriptionTotals &description = partial.descriptionTotals[record.description];
+        description.count++;
+        description.total += record.amount;
+    }
+
+    partial.rowCount = chunk.end - chunk.begin;
+    return partial;
+}
+
+void ReportEngine::mergeReports(Report &result, const Report &partial) {
+    for (auto it = partial.monthly.constBegin(); it != partial.monthly.constEnd(); ++it) {
+        MonthlyTotals &totals = result.monthly[it.key()];
+        totals.income += it.value().income;
+        totals.expense += it.value().expense;
+    }
+
+    for (auto it = partial.categoryTotals.constBegin(); it != partial.categoryTotals.constEnd(); ++it) {
+        result.categoryTotals[it.key()] += it.value();
+    }
+
+    for (auto it = partial.descriptionTotals.constBegin(); it != partial.descriptionTotals.constEnd(); ++it) {
+        DescriptionTotals &totals = result.descriptionTotals[it.key()];
+        totals.count += it.value().count;
+        totals.total += it.value().total;
+    }
+
+    result.rowCount += partial.rowCount;
+}
+
+QVector<QPair<QString, DescriptionTotals>> ReportEngine::topDescriptions(const Report &report, int n) {
+    QVector<QPair<QString, DescriptionTotals>> entries;
+    entries.reserve(report.descriptionTotals.size());
+    for (auto it = report.descriptionTotals.constBegin(); it != report.descriptionTotals.constEnd(); ++it) {
+        entries.append(qMakePair(it.key(), it.value()));
+    }
+
+    int count = qMin(n, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                      [](const QPair<QString, DescriptionTotals> &a, const QPair<QString, DescriptionTotals> &b) {
+                          return a.second.total > b.second.total;
+                      });
+    entries.resize(count);
+    return entries;
+}
+
+qint64 ReportEngine::memoryUsage(const Report &report) {
+    // Keys dominate; each hash/map node adds roughly two pointers and a hash on top of key and value
+    const qint64 node = 2 * sizeof(void *) + 8;
+    qint64 bytes = 0;
+    for (auto it = report.monthly.constBegin(); it != report.monthly.constEnd(); ++it) {
+        bytes += node + sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(MonthlyTotals);
+    }
+    for (auto it = report.categoryTotals.constBegin(); it != report.categoryTotals.constEnd(); ++it) {
+        bytes += node + sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(double);
+    }
+    for (auto it = report.descriptionTotals.constBegin(); it != report.descriptionTotals.constEnd(); ++it) {
+        bytes += node + sizeof(QString) + it.key().capacity() * sizeof(QChar) + sizeof(DescriptionTotals);
+    }
+    return bytes;
+}
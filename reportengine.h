@@ -0,0 +1,49 @@
+#ifndef REPORTENGINE_H
+#define REPORTENGINE_H
+
+#include <QFuture>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "database.h"
+
+struct MonthlyTotals {
+    double income = 0.0;
+    double expense = 0.0;
+};
+
+struct DescriptionTotals {
+    int count = 0;
+    double total = 0.0;
+};
+
+struct Report {
+    QMap<QString, MonthlyTotals> monthly;                // "yyyy-MM" -> income/expense
+    QHash<QString, double> categoryTotals;               // category -> expense total
+    QHash<QString, DescriptionTotals> descriptionTotals; // description -> count/total
+    int rowCount = 0;
+};
+
+// A contiguous date range of the (date-sorted) ledger, aggregated by one worker.
+struct ReportChunk {
+    QSharedPointer<const QVector<TransactionRecord>> records;
+    int begin = 0;
+    int end = 0;
+};
+
+class ReportEngine {
+public:
+    // Splits the records into month-aligned chunks and aggregates them on the global thread pool.
+    static QFuture<Report> run(const QVector<TransactionRecord> &records);
+    static QVector<QPair<QString, DescriptionTotals>> topDescriptions(const Report &report, int n);
+
+    static QVector<ReportChunk> partition(const QSharedPointer<const QVector<TransactionRecord>> &records, int chunkCount);
+    static Report aggregateChunk(const ReportChunk &chunk);
+    static void mergeReports(Report &result, const Report &partial);
+    static qint64 memoryUsage(const Report &report);
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "reportspanel.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QVBoxLayout>
+#include <QDebug>
+#include <QFileDialog>
+#include <QSet>
+#include <algorithm>
+#include <iterator>
+#include "ledgerarchive.h"
+#include "filterexpression.h"
+#include "memoryaccountant.h"
+#include "recurrenceengine.h"
+
+ReportsPanel::ReportsPanel(QWidget *parent)
+    : QWidget(parent) {
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    QHBoxLayout *controls = new QHBoxLayout();
+    controls->setSpacing(10);
+
+    controls->addWidget(new QLabel("Report:"));
+    reportKind = new QComboBox(this);
+    reportKind->addItems({"Monthly Income/Expense", "Category Totals", "Top Descriptions"});
+    controls->addWidget(reportKind);
+
+    controls->addWidget(new QLabel("From:"));
+    fromDate = new QDateEdit(QDate::currentDate().addYears(-1), this);
+    fromDate->setCalendarPopup(true);
+    controls->addWidget(fromDate);
+
+    controls->addWidget(new QLabel("To:"));
+    toDate = new QDateEdit(QDate::currentDate(), this);
+    toDate->setCalendarPopup(true);
+    controls->addWidget(toDate);
+
+    controls->addWidget(new QLabel("Currency:"));
+    reportCurrency = new QComboBox(this);
+    reportCurrency->addItems({"EUR", "USD", "SEK"});
+    controls->addWidget(reportCurrency);
+
+    controls->addWidget(new QLabel("Filter:"));
+    reportFilter = new QLineEdit(this);
+    reportFilter->setPlaceholderText("e.g. category in (Food, Transport)");
+    controls->addWidget(reportFilter);
+
+    controls->addWidget(new QLabel("Top:"));
+    topCount = new QSpinBox(this);
+    topCount->setRange(1, 1000);
+    topCount->setValue(10);
+    controls->addWidget(topCount);
+
+    includeUpcoming = new QCheckBox("Include upcoming recurring", this);
+    includeUpcoming->setToolTip("Adds occurrences of recurring rules that are not booked yet");
+    controls->addWidget(includeUpcoming);
+
+    runButton = new QPushButton("Run Report", this);
+    runButton->setStyleSheet(R"(
+        QPushButton {
+            background-color: #3F51B5;
+            color: white;
+            font-weight: bold;
+            border-radius: 5px;
+            padding: 5px 10px;
+        }
+        QPushButton:hover {
+            background-color: #303F9F;
+        }
+        QPushButton:disabled {
+            background-color: #D3D3D3;
+            color: #A9A9A9;
+        }
+    )");
+    controls->addWidget(runButton);
+
+    archiveButton = new QPushButton("Add Archive...", this);
+    controls->addWidget(archiveButton);
+
+    statusLabel = new QLabel(this);
+    controls->addWidget(statusLabel);
+    controls->addStretch();
+    layout->addLayout(controls);
+
+    resultTable = new QTableWidget(this);
+    resultTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    resultTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    resultTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    resultTable->verticalHeader()->setVisible(false);
+    layout->addWidget(resultTable);
+
+    connect(runButton, &QPushButton::clicked, this, &ReportsPanel::runReport);
+    connect(archiveButton, &QPushButton::clicked, this, &ReportsPanel::addArchive);
+    connect(&watcher, &QFutureWatcher<Report>::finished, this, &ReportsPanel::onReportFinished);
+
+    // Switching report kind or top-N only re-renders the last result
+    connect(reportKind, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ReportsPanel::showReport);
+    connect(topCount, QOverload<int>::of(&QSpinBox::valueChanged), this, &ReportsPanel::showReport);
+    connect(reportCurrency, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ReportsPanel::runReport);
+    connect(reportFilter, &QLineEdit::returnPressed, this, &ReportsPanel::runReport);
+    connect(includeUpcoming, &QCheckBox::toggled, this, &ReportsPanel::runReport);
+
+    MemoryAccountant::registerConsumer("Report results", [this]() { return ReportEngine::memoryUsage(lastReport); }, [this]() {
+        lastReport = Report();
+        statusLabel->setText("Results released to stay within the memory budget; run the report again");
+    });
+    MemoryAccountant::registerConsumer("FX rate cache", [this]() { return fx.memoryUsage(); }, [this]() { fx.clearCache(); });
+}
+
+ReportsPanel::~ReportsPanel() {
+    MemoryAccountant::unregisterConsumer("Report results");
+    MemoryAccountant::unregisterConsumer("FX rate cache");
+}
+
+void ReportsPanel::runReport() {
+    if (watcher.isRunning()) return;
+
+    QString error;
+    QSharedPointer<const FilterExpression> filter = FilterExpression::compile(reportFilter->text(), &error);
+    if (!filter) {
+        statusLabel->setText("Filter error: " + error);
+        return;
+    }
+
+    // SQLite connections are bound to the GUI thread, so rows are fetched here and only aggregation runs in parallel.
+    // The filter runs inside SQLite as a WHERE clause for the database...
+    QVector<TransactionRecord> records = Database::fetchTransactions(fromDate->date(), toDate->date(), &filter->sql());
+
+    // ...and as the predicate program over exported archives, which are queried in place with block skipping.
+    // An export leaves its rows in the database, so archive rows whose id was already fetched are skipped.
+    QSet<int> seenIds;
+    seenIds.reserve(records.size());
+    for (const TransactionRecord &record : records) {
+        seenIds.insert(record.id);
+    }
+
+    QVector<TransactionRecord> extra;
+    auto appendMatching = [&](const QVector<TransactionRecord> &rows, bool dedupe) {
+        QVector<char> mask = filter->isEmpty() ? QVector<char>(rows.size(), 1) : filter->evaluate(LedgerColumns::fromRecords(rows));
+        for (int i = 0; i < rows.size(); ++i) {
+            if (!mask[i]) continue;
+            if (dedupe) {
+                if (seenIds.contains(rows[i].id)) continue;
+                seenIds.insert(rows[i].id);
+            }
+            extra.append(rows[i]);
+        }
+    };
+
+    for (const QString &path : archivePaths) {
+        ArchiveScanStats stats;
+        QVector<TransactionRecord> archived = LedgerArchive::read(path, fromDate->date(), toDate->date(), &stats);
+        qDebug() << "Archive" << path << "read" << stats.blocksRead << "of" << stats.blocksTotal << "blocks," << stats.rowsReturned << "rows";
+        appendMatching(archived, true);
+    }
+
+    // Scheduled occurrences are expanded for this window only, and the engine caches the expansion
+    if (recurrence && includeUpcoming->isChecked()) {
+        appendMatching(recurrence->expand(fromDate->date(), toDate->date()), false);
+    }
+
+    // ReportEngine cuts chunks at month boundaries, so the extra rows are merged in date order
+    if (!extra.isEmpty()) {
+        auto byDate = [](const TransactionRecord &a, const TransactionRecord &b) { return a.date < b.date; };
+        std::stable_sort(extra.begin(), extra.end(), byDate);
+        QVector<TransactionRecord> merged;
+        merged.reserve(records.size() + extra.size());
+        std::merge(records.constBegin(), records.constEnd(), extra.constBegin(), extra.constEnd(), std::back_inserter(merged), byDate);
+        records.swap(merged);
+    }
+
+    // Convert on this thread: the rate cache is shared and the batch is cheap next to aggregation
+    MemoryAccountant::touch("FX rate cache");
+    QStringList missingCurrencies;
+    int unconverted = fx.convertRecords(records, reportCurrency->currentText(), &missingCurrencies);
+    conversionWarning = unconverted > 0 ? QString("%1 rows in %2 had no FX rate into %3 and are not included")
+                                              .arg(unconverted)
+                                              .arg(missingCurrencies.join(", "), reportCurrency->currentText())
+                                        : QString();
+
+    runButton->setEnabled(false);
+    statusLabel->setText(QString("Aggregating %1 rows...").arg(records.size()));
+    timer.start();
+    watcher.setFuture(ReportEngine::run(records));
+}
+
+void ReportsPanel::reloadRates() {
+    fx.load();
+    if (isVisible()) runReport();
+}
+
+void ReportsPanel::addArchive() {
+    QString fileName = QFileDialog::getOpenFileName(this, "Add Archive", "", "Finance Archives (*.ftarc)");
+    if (fileName.isEmpty() || archivePaths.contains(fileName)) return;
+
+    archivePaths.append(fileName);
+    archiveButton->setToolTip(archivePaths.join("\n"));
+    archiveButton->setText(QString("Archives (%1)...").arg(archivePaths.size()));
+    runReport();
+}
+
+void ReportsPanel::onReportFinished() {
+    lastReport = watcher.result();
+    runButton->setEnabled(true);
+    if (conversionWarning.isEmpty()) {
+        statusLabel->setText(QString("%1 rows in %2 ms").arg(lastReport.rowCount).arg(timer.elapsed()));
+        statusLabel->setStyleSheet("");
+    } else {
+        statusLabel->setText(QString("%1 rows in %2 ms - %3").arg(lastReport.rowCount).arg(timer.elapsed()).arg(conversionWarning));
+        statusLabel->setStyleSheet("color: #F44336;");
+    }
+    qDebug() << "Report built over" << lastReport.rowCount << "rows in" << timer.elapsed() << "ms";
+
+    MemoryAccountant::touch("Report results");
+    MemoryAccountant::enforce();
+    MemoryAccountant::logUsage();
+    showReport();
+}
+
+void ReportsPanel::showReport() {
+    resultTable->setRowCount(0);
+    int row = 0;
+
+    switch (reportKind->currentIndex()) {
+    case 0: {
+        resultTable->setColumnCount(4);
+        resultTable->setHorizontalHeaderLabels({"Month", "Income", "Expense", "Net"});
+        for (auto it = lastReport.monthly.constBegin(); it != lastReport.monthly.constEnd(); ++it, ++row) {
+            resultTable->insertRow(row);
+            resultTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+            resultTable->setItem(row, 1, new QTableWidgetItem(QString::number(it.value().income, 'f', 2)));
+            resultTable->setItem(row, 2, new QTableWidgetItem(QString::number(it.value().expense, 'f', 2)));
+            resultTable->setItem(row, 3, new QTableWidgetItem(QString::number(it.value().income - it.value().expense, 'f', 2)));
+        }
+        break;
+    }
+    case 1: {
+        resultTable->setColumnCount(2);
+        resultTable->setHorizontalHeaderLabels({"Category", "Expense"});
+        for (auto it = lastReport.categoryTotals.constBegin(); it != lastReport.categoryTotals.constEnd(); ++it, ++row) {
+            resultTable->insertRow(row);
+            resultTable->setItem(row, 0, new QTableWidgetItem(it.key()));
+            resultTable->setItem(row, 1, new QTableWidgetItem(QString::number(it.value(), 'f', 2)));
+        }
+        resultTable->sortItems(0);
+        break;
+    }
+    default: {
+        resultTable->setColumnCount(3);
+        resultTable->setHorizontalHeaderLabels({"Description", "Count", "Total"});
+        const auto top = ReportEngine::topDescriptions(lastReport, topCount->value());
+        for (const auto &entry : top) {
+            resultTable->insertRow(row);
+            resultTable->setItem(row, 0, new QTableWidgetItem(entry.first));
+            resultTable->setItem(row, 1, new QTableWidgetItem(QString::number(entry.second.count)));
+            resultTable->setItem(row, 2, new QTableWidgetItem(QString::number(entry.second.total, 'f', 2)));
+            row++;
+        }
+        break;
+    }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef REPORTSPANEL_H
+#define REPORTSPANEL_H
+
+#include <QWidget>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDateEdit>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTableWidget>
+#include "reportengine.h"
+#include "fxconverter.h"
+
+class RecurrenceEngine;
+
+class ReportsPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit ReportsPanel(QWidget *parent = nullptr);
+    ~ReportsPanel() override;
+
+    void setRecurrenceEngine(RecurrenceEngine *engine) { recurrence = engine; }
+
+public slots:
+    void runReport();
+    void reloadRates();
+
+private slots:
+    void onReportFinished();
+    void showReport();
+    void addArchive();
+
+private:
+    QDateEdit *fromDate;
+    QDateEdit *toDate;
+    QComboBox *reportKind;
+    QComboBox *reportCurrency;
+    QLineEdit *reportFilter;
+    QSpinBox *topCount;
+    QCheckBox *includeUpcoming;
+    QPushButton *runButton;
+    QPushButton *archiveButton;
+    QLabel *statusLabel;
+    QTableWidget *resultTable;
+
+    QFutureWatcher<Report> watcher;
+    QElapsedTimer timer;
+    Report lastReport;
+    QStringList archivePaths;
+    FxConverter fx;
+    QString conversionWarning;  // rows left out for lack of a rate, shown once the report finishes
+    RecurrenceEngine *recurrence = nullptr;
+};
+
+#endif
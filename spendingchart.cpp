@@ -0,0 +1,357 @@
+#include "spendingchart.h"
+#include "memoryaccountant.h"
+#include <QPainter>
+#include <QPolygonF>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+
+SpendingChart::SpendingChart(QWidget *parent)
+    : QWidget(parent) {
+    setMinimumWidth(250);
+    setMouseTracking(false);
+    setToolTip("Scroll to zoom, drag to pan, double-click to reset");
+
+    MemoryAccountant::registerConsumer("Chart pyramid", [this]() { return memoryUsage(); }, [this]() { releaseRollups(); });
+}
+
+SpendingChart::~SpendingChart() {
+    MemoryAccountant::unregisterConsumer("Chart pyramid");
+}
+
+QSize SpendingChart::sizeHint() const {
+    return QSize(400, 300);
+}
+
+void SpendingChart::setDailyTotals(const QVector<DailyTotal> &totals, double openingBalance) {
+    bool firstData = levels.isEmpty() || dayCount == 0;
+    double oldStart = viewStart + originDay;
+    double oldEnd = viewEnd + originDay;
+
+    buildLevels(totals, openingBalance);
+
+    // Keep the user's zoom across reloads; only the first load frames everything
+    if (firstData) {
+        setView(0, qMax(1, dayCount));
+    } else {
+        setView(oldStart - originDay, oldEnd - originDay);
+    }
+}
+
+void SpendingChart::buildLevels(const QVector<DailyTotal> &totals, double openingBalance) {
+    levels.clear();
+    dayCount = 0;
+    if (totals.isEmpty()) return;
+
+    // Level 0 is dense in days so every coarser level is a fixed-width roll-up
+    originDay = totals.first().date.toJulianDay();
+    dayCount = static_cast<int>(totals.last().date.toJulianDay() - originDay) + 1;
+
+    Level days;
+    days.days = 1;
+    days.buckets.resize(dayCount);
+    for (const DailyTotal &total : totals) {
+        Bucket &bucket = days.buckets[static_cast<int>(total.date.toJulianDay() - originDay)];
+        bucket.spending += total.expense;
+        bucket.balance += total.income - total.expense;
+    }
+
+    double balance = openingBalance;
+    for (Bucket &bucket : days.buckets) {
+        balance += bucket.balance;
+        bucket.balance = balance;
+    }
+    levels.append(days);
+    buildRollups();
+}
+
+void SpendingChart::buildRollups() {
+    levels.resize(1);
+
+    Level weeks;
+    weeks.days = 7;
+    weeks.buckets.resize((dayCount + 6) / 7);
+    const QVector<Bucket> &fine = levels.first().buckets;
+    for (int i = 0; i < dayCount; ++i) {
+        Bucket &bucket = weeks.buckets[i / 7];
+        bucket.spending += fine[i].spending;
+        bucket.balance = fine[i].balance;
+    }
+    levels.append(weeks);
+
+    // Months and years follow the calendar, so their buckets differ in width
+    QDate origin = QDate::fromJulianDay(originDay);
+    for (bool yearly : {false, true}) {
+        const QVector<Bucket> &days = levels.first().buckets;
+        Level level;
+        level.days = yearly ? 365 : 30;
+
+        QDate bucketStart = yearly ? QDate(origin.year(), 1, 1) : QDate(origin.year(), origin.month(), 1);
+        int start = static_cast<int>(bucketStart.toJulianDay() - originDay);
+        while (start < dayCount) {
+            QDate next = yearly ? bucketStart.addYears(1) : bucketStart.addMonths(1);
+            int end = static_cast<int>(next.toJulianDay() - originDay);
+
+            Bucket bucket;
+            for (int i = qMax(0, start); i < qMin(end, dayCount); ++i) {
+                bucket.spending += days[i].spending;
+            }
+            bucket.balance = days[qMin(end, dayCount) - 1].balance;
+            level.starts.append(start);
+            level.buckets.append(bucket);
+
+            bucketStart = next;
+            start = end;
+        }
+        level.starts.append(start);
+        levels.append(level);
+    }
+}
+
+qint64 SpendingChart::memoryUsage() const {
+    qint64 bytes = balancePoints.capacity() * sizeof(QPointF) + spendingPoints.capacity() * sizeof(QPointF);
+    for (const Level &level : levels) {
+        bytes += level.buckets.capacity() * sizeof(Bucket) + level.starts.capacity() * sizeof(int);
+    }
+    return bytes;
+}
+
+void SpendingChart::releaseRollups() {
+    if (levels.size() > 1) levels.resize(1);
+    balancePoints = QVector<QPointF>();
+    spendingPoints = QVector<QPointF>();
+    pointsValid = false;
+}
+
+void SpendingChart::setView(double start, double end) {
+    double span = qMax(7.0, end - start);
+    double limit = qMax(7.0, static_cast<double>(dayCount));
+    span = qMin(span, limit * 1.1);
+
+    viewStart = start;
+    viewEnd = start + span;
+    pointsValid = false;
+    update();
+}
+
+QRectF SpendingChart::plotRect() const {
+    return QRectF(50, 10, qMax(10, width() - 60), qMax(10, height() - 35));
+}
+
+void SpendingChart::updateVisiblePoints() {
+    pointsValid = true;
+    balancePoints.clear();
+    spendingPoints.clear();
+    if (levels.isEmpty()) return;
+    if (levels.size() == 1) buildRollups();
+
+    int pixels = qMax(3, static_cast<int>(plotRect().width()));
+    double span = viewEnd - viewStart;
+
+    // Finest level with at most a few buckets per pixel; LTTB then thins it to the plot width
+    visibleLevel = levels.size() - 1;
+    for (int i = 0; i < levels.size(); ++i) {
+        if (span / levels[i].days <= pixels * MaxBucketsPerPixel) {
+            visibleLevel = i;
+            break;
+        }
+    }
+
+    const Level &level = levels[visibleLevel];
+    int first, last;
+    if (level.starts.isEmpty()) {
+        first = qMax(0, static_cast<int>(qFloor(viewStart / level.days)) - 1);
+        last = qMin(level.buckets.size() - 1, static_cast<int>(qCeil(viewEnd / level.days)) + 1);
+    } else {
+        // One bucket of margin on each side, as for fixed widths
+        auto begin = level.starts.constBegin();
+        first = qMax(0, static_cast<int>(std::upper_bound(begin, level.starts.constEnd(), viewStart) - begin) - 2);
+        last = qMin(level.buckets.size() - 1, static_cast<int>(std::lower_bound(begin, level.starts.constEnd(), viewEnd) - begin));
+    }
+    if (first > last) return;
+
+    QVector<QPointF> balance, spending;
+    balance.reserve(last - first + 1);
+    spending.reserve(last - first + 1);
+    for (int i = first; i <= last; ++i) {
+        double x = level.starts.isEmpty() ? (i + 0.5) * level.days : (level.starts[i] + level.starts[i + 1]) / 2.0;
+        balance.append(QPointF(x, level.buckets[i].balance));
+        spending.append(QPointF(x, level.buckets[i].spending));
+    }
+
+    balancePoints = lttb(balance, pixels);
+    spendingPoints = lttb(spending, pixels);
+}
+
+// Largest-Triangle-Three-Buckets: keeps the visually significant points of a series
+QVector<QPointF> SpendingChart::lttb(const QVector<QPointF> &points, int threshold) {
+    int count = points.size();
+    if (threshold >= count || threshold < 3) return points;
+
+    QVector<QPointF> sampled;
+    sampled.reserve(threshold);
+    sampled.append(points.first());
+
+    double every = static_cast<double>(count - 2) / (threshold - 2);
+    int anchor = 0;
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        int averageStart = static_cast<int>(qFloor((i + 1) * every)) + 1;
+        int averageEnd = qMin(static_cast<int>(qFloor((i + 2) * every)) + 1, count);
+
+        double averageX = 0.0, averageY = 0.0;
+        int averageCount = qMax(1, averageEnd - averageStart);
+        for (int j = averageStart; j < averageEnd; ++j) {
+            averageX += points[j].x();
+            averageY += points[j].y();
+        }
+        averageX /= averageCount;
+        averageY /= averageCount;
+
+        int rangeStart = static_cast<int>(qFloor(i * every)) + 1;
+        int rangeEnd = qMin(static_cast<int>(qFloor((i + 1) * every)) + 1, count - 1);
+
+        double maxArea = -1.0;
+        int chosen = rangeStart;
+        const QPointF &a = points[anchor];
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            double area = qAbs((a.x() - averageX) * (points[j].y() - a.y()) - (a.x() - points[j].x()) * (averageY - a.y()));
+            if (area > maxArea) {
+                maxArea = area;
+                chosen = j;
+            }
+        }
+
+        sampled.append(points[chosen]);
+        anchor = chosen;
+    }
+
+    sampled.append(points.last());
+    return sampled;
+}
+
+void SpendingChart::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.fillRect(rect(), palette().base());
+
+    QRectF plot = plotRect();
+    QColor textColor = palette().text().color();
+
+    if (levels.isEmpty()) {
+        painter.setPen(textColor);
+        painter.drawText(rect(), Qt::AlignCenter, "No transactions to chart");
+        return;
+    }
+
+    MemoryAccountant::touch("Chart pyramid");
+    if (!pointsValid) updateVisiblePoints();
+    if (balancePoints.isEmpty()) return;
+
+    double minBalance = std::numeric_limits<double>::max();
+    double maxBalance = std::numeric_limits<double>::lowest();
+    for (const QPointF &point : balancePoints) {
+        minBalance = qMin(minBalance, point.y());
+        maxBalance = qMax(maxBalance, point.y());
+    }
+    if (maxBalance - minBalance < 1e-9) {
+        maxBalance += 1.0;
+        minBalance -= 1.0;
+    }
+
+    double maxSpending = 0.0;
+    for (const QPointF &point : spendingPoints) {
+        maxSpending = qMax(maxSpending, point.y());
+    }
+
+    double span = viewEnd - viewStart;
+    auto toX = [&](double day) { return plot.left() + (day - viewStart) / span * plot.width(); };
+
+    painter.setPen(QPen(QColor(128, 128, 128, 80), 1));
+    painter.drawRect(plot);
+
+    // Spending as bars against their own scale, drawn behind the balance line
+    if (maxSpending > 0) {
+        painter.setPen(QPen(QColor(244, 67, 54, 110), 1));
+        for (const QPointF &point : spendingPoints) {
+            double x = toX(point.x());
+            if (x < plot.left() || x > plot.right()) continue;
+            double h = point.y() / maxSpending * plot.height() * 0.4;
+            painter.drawLine(QPointF(x, plot.bottom()), QPointF(x, plot.bottom() - h));
+        }
+    }
+
+    QPolygonF line;
+    line.reserve(balancePoints.size());
+    for (const QPointF &point : balancePoints) {
+        double y = plot.bottom() - (point.y() - minBalance) / (maxBalance - minBalance) * plot.height();
+        line.append(QPointF(toX(point.x()), y));
+    }
+
+    painter.save();
+    painter.setClipRect(plot);
+    painter.setPen(QPen(QColor("#2196F3"), 2));
+    painter.drawPolyline(line);
+    painter.restore();
+
+    static const char *levelNames[] = {"daily", "weekly", "monthly", "yearly"};
+    painter.setPen(textColor);
+    painter.drawText(QRectF(0, plot.top(), plot.left() - 4, 16), Qt::AlignRight, QString::number(maxBalance, 'f', 0));
+    painter.drawText(QRectF(0, plot.bottom() - 16, plot.left() - 4, 16), Qt::AlignRight, QString::number(minBalance, 'f', 0));
+    painter.drawText(QRectF(plot.left(), plot.bottom() + 4, plot.width(), 16), Qt::AlignLeft,
+                     QDate::fromJulianDay(originDay + qRound64(viewStart)).toString("yyyy-MM-dd"));
+    painter.drawText(QRectF(plot.left(), plot.bottom() + 4, plot.width(), 16), Qt::AlignRight,
+                     QDate::fromJulianDay(originDay + qRound64(viewEnd)).toString("yyyy-MM-dd"));
+    painter.drawText(QRectF(plot.left(), plot.bottom() + 4, plot.width(), 16), Qt::AlignHCenter,
+                     QString("Balance (%1, %2 pts)").arg(levelNames[visibleLevel]).arg(balancePoints.size()));
+}
+
+void SpendingChart::resizeEvent(QResizeEvent *event) {
+    pointsValid = false;
+    QWidget::resizeEvent(event);
+}
+
+void SpendingChart::wheelEvent(QWheelEvent *event) {
+    if (levels.isEmpty()) return;
+
+    QRectF plot = plotRect();
+    double span = viewEnd - viewStart;
+    double anchorRatio = qBound(0.0, (event->position().x() - plot.left()) / plot.width(), 1.0);
+    double anchorDay = viewStart + anchorRatio * span;
+
+    // Zoom around the cursor so the day under it stays put
+    double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    double newSpan = span * factor;
+    setView(anchorDay - anchorRatio * newSpan, anchorDay + (1.0 - anchorRatio) * newSpan);
+    event->accept();
+}
+
+void SpendingChart::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        dragging = true;
+        dragOrigin = event->localPos();
+        dragViewStart = viewStart;
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void SpendingChart::mouseMoveEvent(QMouseEvent *event) {
+    if (dragging) {
+        double span = viewEnd - viewStart;
+        double shift = (event->localPos().x() - dragOrigin.x()) / plotRect().width() * span;
+        setView(dragViewStart - shift, dragViewStart - shift + span);
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+void SpendingChart::mouseReleaseEvent(QMouseEvent *event) {
+    dragging = false;
+    QWidget::mouseReleaseEvent(event);
+}
+
+void SpendingChart::mouseDoubleClickEvent(QMouseEvent *event) {
+    setView(0, qMax(1, dayCount));
+    QWidget::mouseDoubleClickEvent(event);
+}
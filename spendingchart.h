@@ -0,0 +1,77 @@
+#ifndef SPENDINGCHART_H
+#define SPENDINGCHART_H
+
+#include <QWidget>
+#include <QPointF>
+#include <QVector>
+#include "database.h"
+
+// Balance and spending over time. Daily totals are rolled up into a pyramid of
+// day/week/calendar-month/calendar-year buckets; each frame picks the finest level with at most
+// a few buckets per pixel and LTTB-downsamples it to the plot width,
+// so pan and zoom cost is bounded by the widget width, not the ledger size.
+class SpendingChart : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit SpendingChart(QWidget *parent = nullptr);
+    ~SpendingChart() override;
+
+    // openingBalance is the net of everything before the first total, such as archived years
+    void setDailyTotals(const QVector<DailyTotal> &totals, double openingBalance = 0.0);
+    QSize sizeHint() const override;
+
+    qint64 memoryUsage() const;
+    // Drops the week/month/year roll-ups; they are rebuilt from the daily level on the next paint
+    void releaseRollups();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    struct Bucket {
+        double spending = 0.0;  // sum of expenses in the bucket
+        double balance = 0.0;   // running balance at the end of the bucket
+    };
+
+    struct Level {
+        int days = 1;             // bucket width; the average width for calendar levels
+        QVector<Bucket> buckets;  // bucket i covers days [i * days, (i + 1) * days) from originDay...
+        QVector<int> starts;      // ...unless set: then it covers [starts[i], starts[i + 1]), with one trailing end
+    };
+
+    void buildLevels(const QVector<DailyTotal> &totals, double openingBalance);
+    void buildRollups();
+    void updateVisiblePoints();
+    void setView(double start, double end);
+    QRectF plotRect() const;
+
+    static QVector<QPointF> lttb(const QVector<QPointF> &points, int threshold);
+
+    static const int MaxBucketsPerPixel = 4;
+
+    QVector<Level> levels;
+    qint64 originDay = 0;
+    int dayCount = 0;
+
+    double viewStart = 0.0;  // days from originDay
+    double viewEnd = 0.0;
+
+    // Points for the current frame, in day units; rebuilt only when the view or size changes
+    QVector<QPointF> balancePoints;
+    QVector<QPointF> spendingPoints;
+    int visibleLevel = 0;
+    bool pointsValid = false;
+
+    bool dragging = false;
+    QPointF dragOrigin;
+    double dragViewStart = 0.0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include <QtTest>
+#include <algorithm>
+#include "database.h"
+#include "filterexpression.h"
+
+// Runs each filter both as a SQL WHERE clause and as a predicate program over
+// the same rows, including non-ASCII text and NULL descriptions, and expects
+// the two forms to select the same ids
+class TestFilterExpression : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void sqlMatchesPredicate_data();
+    void sqlMatchesPredicate();
+
+private:
+    static QList<int> sortedIds(const QVector<TransactionRecord> &records, const QVector<char> &mask);
+
+    QDate from = QDate(2024, 1, 1);
+    QDate to = QDate(2024, 12, 31);
+};
+
+void TestFilterExpression::initTestCase() {
+    QVERIFY(Database::initialize(":memory:"));
+
+    QVERIFY(Database::addTransaction("2024-01-05", "Food", "Café Central", 4.5, "Expense"));
+    QVERIFY(Database::addTransaction("2024-01-06", "Food", "CAFÉ CENTRAL", 5.0, "Expense"));
+    QVERIFY(Database::addTransaction("2024-01-07", "Ärzte", "Zahnarzt", 80.0, "Expense"));
+    QVERIFY(Database::addTransaction("2024-01-08", "ärzte", QString(), 20.0, "Expense", "SEK"));
+    QVERIFY(Database::addTransaction("2024-01-09", "Salary", QString(), 3000.0, "Income"));
+    QVERIFY(Database::addTransaction("2024-01-10", "Transport", "Straße 50% off", 12.0, "Expense", "USD"));
+}
+
+void TestFilterExpression::sqlMatchesPredicate_data() {
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("contains with a non-ASCII needle") << "desc ~ \"café\"" << 1;
+    QTest::newRow("contains folds ASCII") << "desc ~ \"CAF\"" << 2;
+    QTest::newRow("negated contains keeps NULL descriptions") << "not desc ~ \"café\"" << 5;
+    QTest::newRow("not equal keeps NULL descriptions") << "desc != \"zahnarzt\"" << 5;
+    QTest::newRow("non-ASCII category") << "category = ärzte" << 1;
+    QTest::newRow("in with non-ASCII values") << "category in (ÄRZTE, food)" << 3;
+    QTest::newRow("percent stays literal") << "desc ~ \"50%\"" << 1;
+    QTest::newRow("negated or over NULL") << "not (desc ~ \"a\" or currency = sek)" << 1;
+    QTest::newRow("type and amount") << "type = income and amount > 100" << 1;
+}
+
+void TestFilterExpression::sqlMatchesPredicate() {
+    QFETCH(QString, filter);
+    QFETCH(int, expected);
+
+    QString error;
+    QSharedPointer<const FilterExpression> expression = FilterExpression::compile(filter, &error);
+    QVERIFY2(expression, qPrintable(error));
+
+    QVector<TransactionRecord> all = Database::fetchTransactions(from, to);
+    QCOMPARE(all.size(), 6);
+    QList<int> predicateIds = sortedIds(all, expression->evaluate(LedgerColumns::fromRecords(all)));
+
+    QVector<TransactionRecord> selected = Database::fetchTransactions(from, to, &expression->sql());
+    QList<int> sqlIds = sortedIds(selected, QVector<char>(selected.size(), 1));
+
+    QCOMPARE(sqlIds, predicateIds);
+    QCOMPARE(sqlIds.size(), expected);
+}
+
+QList<int> TestFilterExpression::sortedIds(const QVector<TransactionRecord> &records, const QVector<char> &mask) {
+    QList<int> ids;
+    for (int i = 0; i < records.size(); ++i) {
+        if (mask[i]) ids.append(records[i].id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+QTEST_GUILESS_MAIN(TestFilterExpression)
+#include "tst_filterexpression.moc"
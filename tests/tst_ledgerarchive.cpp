@@ -0,0 +1,145 @@
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QTemporaryDir>
+#include <algorithm>
+#include "database.h"
+#include "ledgerarchive.h"
+
+// Round-trips an in-memory SQLite ledger through the .ftarc codec and compares field by field
+class TestLedgerArchive : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fullRoundTrip();
+    void windowSkipsBlocks();
+    void windowInDateGap();
+    void windowOutsideArchive();
+    void emptyLedger();
+
+private:
+    static void sortRecords(QVector<TransactionRecord> &records);
+    static void compareRecords(QVector<TransactionRecord> actual, QVector<TransactionRecord> expected);
+
+    QTemporaryDir dir;
+    QString archivePath;
+    int rowCount = 10000;
+    QDate gapStart;
+    QDate gapEnd;
+};
+
+void TestLedgerArchive::initTestCase() {
+    QVERIFY(dir.isValid());
+    QVERIFY(Database::initialize(":memory:"));
+
+    static const char *categories[] = {"Food", "Rent", "Entertainment", "Transport", "Other"};
+    static const char *currencies[] = {"EUR", "USD", "SEK"};
+
+    QSqlDatabase db = QSqlDatabase::database();
+    db.transaction();
+
+    QDate day(2015, 1, 1);
+    for (int i = 0; i < rowCount; ++i) {
+        // Several rows share a day, and a 400-day hole opens in the middle of the third block
+        if (i > 0 && i % 5 == 0) day = day.addDays(1 + (i % 35 == 0 ? 3 : 0));
+        if (i == 9000) {
+            gapStart = day.addDays(1);
+            day = day.addDays(400);
+            gapEnd = day.addDays(-1);
+        }
+
+        TransactionRecord record;
+        // Ids jump unevenly, including one jump far past the previous block
+        record.id = i < 5000 ? 1 + i * 3 : 200000 + i * 7;
+        record.date = day;
+        record.category = categories[i % 5];
+        record.description = i % 11 == 0 ? QString() : i % 13 == 0 ? QString("Unique %1").arg(i) : QString("Café #%1").arg(i % 17);
+        record.amount = ((i * 37) % 20001 - 10000) / 100.0;
+        record.type = i % 4 == 0 ? "Income" : "Expense";
+        record.currency = currencies[i % 3];
+        QVERIFY(Database::insertTransaction(record));
+    }
+    QVERIFY(db.commit());
+
+    archivePath = dir.filePath("ledger.ftarc");
+    QVERIFY(LedgerArchive::write(archivePath, Database::fetchTransactions(QDate(), QDate())));
+}
+
+void TestLedgerArchive::sortRecords(QVector<TransactionRecord> &records) {
+    std::sort(records.begin(), records.end(), [](const TransactionRecord &a, const TransactionRecord &b) {
+        return a.date < b.date || (a.date == b.date && a.id < b.id);
+    });
+}
+
+void TestLedgerArchive::compareRecords(QVector<TransactionRecord> actual, QVector<TransactionRecord> expected) {
+    sortRecords(actual);
+    sortRecords(expected);
+    QCOMPARE(actual.size(), expected.size());
+
+    for (int i = 0; i < actual.size(); ++i) {
+        QCOMPARE(actual[i].id, expected[i].id);
+        QCOMPARE(actual[i].date, expected[i].date);
+        QCOMPARE(actual[i].category, expected[i].category);
+        QCOMPARE(actual[i].description, expected[i].description);
+        QCOMPARE(qRound64(actual[i].amount * 100), qRound64(expected[i].amount * 100));
+        QCOMPARE(actual[i].type, expected[i].type);
+        QCOMPARE(actual[i].currency, expected[i].currency);
+    }
+}
+
+void TestLedgerArchive::fullRoundTrip() {
+    ArchiveScanStats stats;
+    QVector<TransactionRecord> archived = LedgerArchive::read(archivePath, QDate(), QDate(), &stats);
+
+    int blocks = (rowCount + LedgerArchive::BlockRows - 1) / LedgerArchive::BlockRows;
+    QCOMPARE(stats.blocksTotal, blocks);
+    QCOMPARE(stats.blocksRead, blocks);
+    QCOMPARE(stats.rowsReturned, rowCount);
+    compareRecords(archived, Database::fetchTransactions(QDate(), QDate()));
+}
+
+void TestLedgerArchive::windowSkipsBlocks() {
+    // A window inside the second block must not decode the first or the third
+    QVector<TransactionRecord> all = Database::fetchTransactions(QDate(), QDate());
+    sortRecords(all);
+    QDate from = all[5000].date;
+    QDate to = all[6000].date;
+
+    ArchiveScanStats stats;
+    QVector<TransactionRecord> archived = LedgerArchive::read(archivePath, from, to, &stats);
+
+    QCOMPARE(stats.blocksRead, 1);
+    QVERIFY(!archived.isEmpty());
+    compareRecords(archived, Database::fetchTransactions(from, to));
+}
+
+void TestLedgerArchive::windowInDateGap() {
+    // The block spans the gap, so it is decoded but contributes no rows
+    ArchiveScanStats stats;
+    QVector<TransactionRecord> archived = LedgerArchive::read(archivePath, gapStart, gapEnd, &stats);
+
+    QCOMPARE(stats.blocksRead, 1);
+    QVERIFY(archived.isEmpty());
+    QVERIFY(Database::fetchTransactions(gapStart, gapEnd).isEmpty());
+}
+
+void TestLedgerArchive::windowOutsideArchive() {
+    ArchiveScanStats stats;
+    QVector<TransactionRecord> archived = LedgerArchive::read(archivePath, QDate(2000, 1, 1), QDate(2014, 12, 31), &stats);
+
+    QCOMPARE(stats.blocksRead, 0);
+    QVERIFY(archived.isEmpty());
+}
+
+void TestLedgerArchive::emptyLedger() {
+    QString path = dir.filePath("empty.ftarc");
+    QVERIFY(LedgerArchive::write(path, QVector<TransactionRecord>()));
+
+    ArchiveScanStats stats;
+    QVector<TransactionRecord> archived = LedgerArchive::read(path, QDate(), QDate(), &stats);
+    QCOMPARE(stats.blocksTotal, 0);
+    QVERIFY(archived.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestLedgerArchive)
+#include "tst_ledgerarchive.moc"
@@ -0,0 +1,197 @@
+#include <QtTest>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include "recurrenceengine.h"
+
+// Occurrence arithmetic at the edges: month-end clamping, leap days, BYMONTHDAY
+// before the start day, windows far from the start, and COUNT ending mid-window.
+// Materialization runs against a temporary database file with one archived year.
+class TestRecurrenceEngine : public QObject {
+    Q_OBJECT
+
+private slots:
+    void occurrences_data();
+    void occurrences();
+    void nextOccurrence_data();
+    void nextOccurrence();
+    void materializeDue();
+
+private:
+    static QDate day(const char *text) { return QDate::fromString(text, "yyyy-MM-dd"); }
+    static QStringList bookedDates(const QString &description);
+    static QStringList dates(const QVector<TransactionRecord> &records);
+};
+
+void TestRecurrenceEngine::occurrences_data() {
+    QTest::addColumn<QString>("rrule");
+    QTest::addColumn<QDate>("start");
+    QTest::addColumn<QDate>("from");
+    QTest::addColumn<QDate>("to");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("monthly on the 31st clamps to month end")
+        << "FREQ=MONTHLY" << day("2024-01-31") << day("2024-01-01") << day("2024-06-30")
+        << QStringList{"2024-01-31", "2024-02-29", "2024-03-31", "2024-04-30", "2024-05-31", "2024-06-30"};
+    QTest::newRow("monthly on the 31st, window a year later")
+        << "FREQ=MONTHLY" << day("2024-01-31") << day("2025-02-01") << day("2025-03-31")
+        << QStringList{"2025-02-28", "2025-03-31"};
+
+    QTest::newRow("yearly on Feb 29 falls back to Feb 28")
+        << "FREQ=YEARLY" << day("2024-02-29") << day("2024-01-01") << day("2028-12-31")
+        << QStringList{"2024-02-29", "2025-02-28", "2026-02-28", "2027-02-28", "2028-02-29"};
+    QTest::newRow("yearly on Feb 29, window in a common year")
+        << "FREQ=YEARLY" << day("2024-02-29") << day("2029-01-01") << day("2029-12-31")
+        << QStringList{"2029-02-28"};
+
+    QTest::newRow("BYMONTHDAY before the start day skips the first month")
+        << "FREQ=MONTHLY;BYMONTHDAY=5" << day("2024-01-20") << day("2024-01-01") << day("2024-03-31")
+        << QStringList{"2024-02-05", "2024-03-05"};
+    QTest::newRow("BYMONTHDAY before the start day counts from the first real occurrence")
+        << "FREQ=MONTHLY;BYMONTHDAY=5;COUNT=3" << day("2024-01-20") << day("2024-01-01") << day("2024-12-31")
+        << QStringList{"2024-02-05", "2024-03-05", "2024-04-05"};
+    QTest::newRow("BYMONTHDAY=31 clamps in short months")
+        << "FREQ=MONTHLY;BYMONTHDAY=31" << day("2024-04-10") << day("2024-04-01") << day("2024-06-30")
+        << QStringList{"2024-04-30", "2024-05-31", "2024-06-30"};
+
+    QTest::newRow("monthly interval 5, window thirty years out")
+        << "FREQ=MONTHLY;INTERVAL=5" << day("2000-03-15") << day("2030-01-01") << day("2030-12-31")
+        << QStringList{"2030-03-15", "2030-08-15"};
+    QTest::newRow("weekly interval 3, window years out")
+        << "FREQ=WEEKLY;INTERVAL=3" << day("2020-01-01") << day("2030-01-01") << day("2030-01-31")
+        << QStringList{"2030-01-02", "2030-01-23"};
+    QTest::newRow("daily interval 7, window between occurrences")
+        << "FREQ=DAILY;INTERVAL=7" << day("2024-01-01") << day("2024-03-05") << day("2024-03-10")
+        << QStringList();
+
+    QTest::newRow("COUNT ends inside the window")
+        << "FREQ=WEEKLY;COUNT=4" << day("2024-01-10") << day("2024-01-15") << day("2024-03-01")
+        << QStringList{"2024-01-17", "2024-01-24", "2024-01-31"};
+    QTest::newRow("COUNT with an interval ends inside the window")
+        << "FREQ=DAILY;INTERVAL=2;COUNT=5" << day("2024-01-01") << day("2024-01-04") << day("2024-01-31")
+        << QStringList{"2024-01-05", "2024-01-07", "2024-01-09"};
+    QTest::newRow("COUNT ended before the window")
+        << "FREQ=MONTHLY;COUNT=2" << day("2024-01-31") << day("2024-03-01") << day("2024-12-31")
+        << QStringList();
+    QTest::newRow("UNTIL ends inside the window")
+        << "FREQ=MONTHLY;UNTIL=20240415" << day("2024-01-31") << day("2024-02-01") << day("2024-12-31")
+        << QStringList{"2024-02-29", "2024-03-31"};
+}
+
+void TestRecurrenceEngine::occurrences() {
+    QFETCH(QString, rrule);
+    QFETCH(QDate, start);
+    QFETCH(QDate, from);
+    QFETCH(QDate, to);
+    QFETCH(QStringList, expected);
+
+    RecurrenceEngine::Pattern pattern;
+    QString error;
+    QVERIFY2(RecurrenceEngine::parse(rrule, &pattern, &error), qPrintable(error));
+
+    QStringList actual;
+    for (const QDate &date : RecurrenceEngine::occurrences(start, pattern, from, to)) {
+        actual << date.toString("yyyy-MM-dd");
+    }
+    QCOMPARE(actual, expected);
+}
+
+void TestRecurrenceEngine::nextOccurrence_data() {
+    QTest::addColumn<QString>("rrule");
+    QTest::addColumn<QDate>("start");
+    QTest::addColumn<QDate>("after");
+    QTest::addColumn<QDate>("expected");
+
+    QTest::newRow("before the start") << "FREQ=MONTHLY" << day("2024-01-31") << day("2023-06-01") << day("2024-01-31");
+    QTest::newRow("on an occurrence") << "FREQ=MONTHLY" << day("2024-01-31") << day("2024-01-31") << day("2024-02-29");
+    QTest::newRow("after a clamped occurrence") << "FREQ=MONTHLY" << day("2024-01-31") << day("2024-02-29") << day("2024-03-31");
+    QTest::newRow("BYMONTHDAY before the start day")
+        << "FREQ=MONTHLY;BYMONTHDAY=5" << day("2024-01-20") << day("2024-01-19") << day("2024-02-05");
+    QTest::newRow("next one years away") << "FREQ=YEARLY;INTERVAL=10" << day("2024-02-29") << day("2026-01-01") << day("2034-02-28");
+    QTest::newRow("COUNT used up") << "FREQ=WEEKLY;COUNT=4" << day("2024-01-10") << day("2024-01-31") << QDate();
+    QTest::newRow("past UNTIL") << "FREQ=DAILY;UNTIL=20240110" << day("2024-01-01") << day("2024-01-10") << QDate();
+}
+
+void TestRecurrenceEngine::nextOccurrence() {
+    QFETCH(QString, rrule);
+    QFETCH(QDate, start);
+    QFETCH(QDate, after);
+    QFETCH(QDate, expected);
+
+    RecurrenceEngine::Pattern pattern;
+    QVERIFY(RecurrenceEngine::parse(rrule, &pattern));
+    QCOMPARE(RecurrenceEngine::nextOccurrence(start, pattern, after), expected);
+}
+
+void TestRecurrenceEngine::materializeDue() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(Database::initialize(dir.filePath("ledger.db")));
+
+    QVERIFY(Database::addTransaction("2020-06-01", "Rent", "Old rent", 500.0, "Expense"));
+    QVERIFY(Database::archiveYear(2020));
+
+    RecurringRule rule;
+    rule.description = "Gym";
+    rule.category = "Health";
+    rule.amount = 30.0;
+    rule.type = "Expense";
+    rule.startDate = day("2020-11-15");
+    rule.rrule = "FREQ=MONTHLY";
+    QVERIFY(Database::addRecurringRule(rule));
+
+    RecurrenceEngine engine;
+    engine.load();
+    QCOMPARE(engine.rules().size(), 1);
+    int ruleId = engine.rules().first().id;
+
+    // The 2020 occurrences fall in the archived year and are skipped for good
+    QCOMPARE(dates(engine.materializeDue(day("2021-02-20"))), (QStringList{"2021-01-15", "2021-02-15"}));
+    QCOMPARE(bookedDates("Gym"), (QStringList{"2021-01-15", "2021-02-15"}));
+    QCOMPARE(Database::fetchTransactions(day("2020-01-01"), day("2020-12-31")).size(), 1);
+    QCOMPARE(engine.rules().first().materializedThrough, day("2021-02-20"));
+
+    // Nothing new is due until the next occurrence's day
+    QVERIFY(engine.materializeDue(day("2021-02-20")).isEmpty());
+    QVERIFY(engine.materializeDue(day("2021-03-14")).isEmpty());
+    QCOMPARE(dates(engine.materializeDue(day("2021-03-15"))), QStringList{"2021-03-15"});
+
+    // A marker another process already moved makes the compare-and-swap fail without booking
+    TransactionRecord late;
+    late.date = day("2021-04-15");
+    late.category = rule.category;
+    late.description = rule.description;
+    late.amount = rule.amount;
+    late.type = rule.type;
+    QVERIFY(!Database::materializeRule(ruleId, day("2021-02-20"), day("2021-04-30"), {late}));
+    QCOMPARE(bookedDates("Gym"), (QStringList{"2021-01-15", "2021-02-15", "2021-03-15"}));
+
+    QVERIFY(Database::materializeRule(ruleId, day("2021-03-15"), day("2021-04-30"), {late}));
+    QCOMPARE(bookedDates("Gym").size(), 4);
+
+    // A stale engine loses the swap, reloads the marker, and books nothing twice
+    QVERIFY(engine.materializeDue(day("2021-04-30")).isEmpty());
+    QCOMPARE(engine.rules().first().materializedThrough, day("2021-04-30"));
+    QCOMPARE(bookedDates("Gym").size(), 4);
+}
+
+QStringList TestRecurrenceEngine::bookedDates(const QString &description) {
+    QSqlQuery query;
+    query.prepare("SELECT date FROM transactions WHERE description = ? ORDER BY date");
+    query.addBindValue(description);
+    QStringList result;
+    if (query.exec()) {
+        while (query.next()) result << query.value(0).toString();
+    }
+    return result;
+}
+
+QStringList TestRecurrenceEngine::dates(const QVector<TransactionRecord> &records) {
+    QStringList result;
+    for (const TransactionRecord &record : records) {
+        result << record.date.toString("yyyy-MM-dd");
+    }
+    return result;
+}
+
+QTEST_GUILESS_MAIN(TestRecurrenceEngine)
+#include "tst_recurrenceengine.moc"